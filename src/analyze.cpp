@@ -0,0 +1,51 @@
+#include <iostream>
+#include <iomanip>
+
+#include "rom_cache.hpp"
+
+// Bytes of the map printed on each line
+#define MAP_LINE_SIZE 64
+
+int main(int argc, char* argv[]) {
+	std::shared_ptr<const ROMImage> image;
+	int address_iterator;
+	// Characters printed for each kind of byte in the map
+	const char map_characters[] = { '.', 'C', 'D' };
+
+	// Check to ensure a program to analyze has been passed in
+	if (argc != 2) {
+		std::cout << "Proper Usage:\n    chip8-analyze <path_to_program>" << std::endl;
+		return 0;
+	}
+	image = ROMCache::load(argv[1]);
+	if (image == nullptr) {
+		return 1;
+	}
+	const ROMAnalysis & analysis = image->analysis;
+
+	std::cout << "Program:     " << argv[1] << " (" << image->length << " bytes)" << std::endl;
+	std::cout << "Code bytes:  " << analysis.code_bytes << std::endl;
+	std::cout << "Data bytes:  " << analysis.data_bytes << std::endl;
+	std::cout << "Quirks:      " << analysis.profile
+		<< " (shift_vy=" << (int) analysis.quirks.shift_vy
+		<< " load_store_index=" << (int) analysis.quirks.load_store_index
+		<< " jump_vx=" << (int) analysis.quirks.jump_vx
+		<< " logic_reset_vf=" << (int) analysis.quirks.logic_reset_vf << ")" << std::endl;
+	std::cout << "Self-modifying writes:";
+	for (uint16_t address : analysis.self_modifying) {
+		std::cout << " 0x" << std::hex << std::uppercase << address << std::dec;
+	}
+	std::cout << (analysis.self_modifying.empty() ? " none" : "") << std::endl;
+
+	// Print the map of the program, C for code, D for sprite data and . for unknown
+	std::cout << std::endl << "Map (C code, D data, . unknown):" << std::endl;
+	for (address_iterator = PROGRAM_START; address_iterator < PROGRAM_START + image->length; address_iterator++) {
+		if ((address_iterator - PROGRAM_START) % MAP_LINE_SIZE == 0) {
+			std::cout << (address_iterator == PROGRAM_START ? "" : "\n") << "0x" << std::hex << std::uppercase
+				<< std::setw(3) << std::setfill('0') << address_iterator << std::dec << " ";
+		}
+		std::cout << map_characters[analysis.map[address_iterator]];
+	}
+	std::cout << std::endl;
+	return 0;
+}
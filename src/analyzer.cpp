@@ -0,0 +1,216 @@
+#include "analyzer.hpp"
+
+// Walks the control flow of a program from PROGRAM_START
+void ROMAnalyzer::analyze(const uint8_t * program, int length, ROMAnalysis * result) {
+	uint8_t memory[MEMORY_SIZE];
+	uint8_t visited[MEMORY_SIZE];
+	std::vector<Branch> branches;
+	std::vector<Write> writes;
+	Branch branch;
+	uint16_t opcode;
+	uint16_t address;
+	uint8_t  x;
+	uint8_t  y;
+	uint8_t  walking;
+	uint8_t  index_stale;
+	uint8_t  uses_schip;
+	uint8_t  shifts_vy;
+	uint8_t  reuses_index;
+	int byte_iterator;
+
+	memset(memory, 0, sizeof(memory));
+	memset(visited, 0, sizeof(visited));
+	memset(result->map, ROM_BYTE_UNKNOWN, sizeof(result->map));
+	memset(result->code_pages, 0, sizeof(result->code_pages));
+	result->self_modifying.clear();
+	memcpy(&memory[PROGRAM_START], program, length);
+
+	uses_schip = 0;
+	shifts_vy = 0;
+	reuses_index = 0;
+	branches.push_back(Branch { PROGRAM_START, 0, 0 });
+	while (! branches.empty()) {
+		branch = branches.back();
+		branches.pop_back();
+		address = branch.address;
+		// I has not been used since a load or store changed it on this path
+		index_stale = 0;
+		walking = 1;
+		while (walking) {
+			// Stop at code already walked or outside of the program
+			if (address < PROGRAM_START || address + 1 >= PROGRAM_START + length || visited[address]) {
+				break;
+			}
+			visited[address] = 1;
+			ROMAnalyzer::mark(result, address, 2, ROM_BYTE_CODE);
+			opcode = memory[address] << 8 | memory[address + 1];
+			x = (opcode & 0x0F00) >> 8;
+			y = (opcode & 0x00F0) >> 4;
+			address += 2;
+
+			switch (opcode & 0xF000) {
+				case 0x0000:
+					// 0x00EE Returns from subroutine
+					if (opcode == 0x00EE) {
+						walking = 0;
+					}
+					// 0x00CN, 0x00FB-0x00FF SUPER-CHIP scrolling, exit and resolution
+					if ((opcode & 0xFFF0) == 0x00C0 || (opcode >= 0x00FB && opcode <= 0x00FF)) {
+						uses_schip = 1;
+						walking = opcode != 0x00FD;
+					}
+				break;
+				// 0x1NNN Jumps to address NNN
+				case 0x1000:
+					branches.push_back(Branch { (uint16_t) (opcode & 0x0FFF), branch.index_known, branch.index });
+					walking = 0;
+				break;
+				// 0x2NNN Calls subroutine at NNN, continuing after it returns
+				case 0x2000:
+					branches.push_back(Branch { (uint16_t) (opcode & 0x0FFF), branch.index_known, branch.index });
+				break;
+				// 0x3XNN, 0x4XNN, 0x5XY0, 0x9XY0 Skips the next instruction
+				case 0x3000:
+				case 0x4000:
+				case 0x5000:
+				case 0x9000:
+					branches.push_back(Branch { (uint16_t) (address + 2), branch.index_known, branch.index });
+				break;
+				case 0x8000:
+					// 0x8XY6/0x8XYE shifting another register only makes sense if VY is shifted into VX.
+					// Assemblers write a shift of VX in place as 0x8X06/0x8X0E, so Y=0 says nothing.
+					if (((opcode & 0x000F) == 0x6 || (opcode & 0x000F) == 0xE) && x != y && y != 0) {
+						shifts_vy = 1;
+					}
+				break;
+				// 0xANNN Sets I to the address NNN
+				case 0xA000:
+					branch.index_known = 1;
+					branch.index = opcode & 0x0FFF;
+					index_stale = 0;
+				break;
+				// 0xBNNN Jumps to the address NNN plus a register
+				case 0xB000:
+					branches.push_back(Branch { (uint16_t) (opcode & 0x0FFF), branch.index_known, branch.index });
+					walking = 0;
+				break;
+				// 0xDXYN Draws N rows of sprite data starting at I
+				case 0xD000:
+					reuses_index |= index_stale;
+					index_stale = 0;
+					if ((opcode & 0x000F) == 0) {
+						uses_schip = 1;
+					}
+					if (branch.index_known) {
+						ROMAnalyzer::mark(result, branch.index, (opcode & 0x000F) ? (opcode & 0x000F) : 32, ROM_BYTE_DATA);
+					}
+				break;
+				// 0xEX9E, 0xEXA1 Skips the next instruction depending on a key
+				case 0xE000:
+					branches.push_back(Branch { (uint16_t) (address + 2), branch.index_known, branch.index });
+				break;
+				case 0xF000:
+					switch (opcode & 0x00FF) {
+						// 0xFX1E Adds VX to I
+						case 0x001E:
+							reuses_index |= index_stale;
+							index_stale = 0;
+							branch.index_known = 0;
+						break;
+						// 0xFX29 Sets I to a font character
+						case 0x0029:
+							branch.index_known = 0;
+							index_stale = 0;
+						break;
+						// 0xFX30 Sets I to a SUPER-CHIP large font character
+						case 0x0030:
+							uses_schip = 1;
+							branch.index_known = 0;
+							index_stale = 0;
+						break;
+						// 0xFX75, 0xFX85 SUPER-CHIP flag registers
+						case 0x0075:
+						case 0x0085:
+							uses_schip = 1;
+						break;
+						// 0xFX33 Writes 3 bytes at I
+						case 0x0033:
+							reuses_index |= index_stale;
+							index_stale = 0;
+							if (branch.index_known) {
+								writes.push_back(Write { (uint16_t) (address - 2), branch.index, 3 });
+							}
+						break;
+						// 0xFX55 Writes X + 1 bytes at I
+						case 0x0055:
+							reuses_index |= index_stale;
+							if (branch.index_known) {
+								writes.push_back(Write { (uint16_t) (address - 2), branch.index, (uint8_t) (x + 1) });
+							}
+							// Where I ends up depends on the interpreter
+							branch.index_known = 0;
+							index_stale = 1;
+						break;
+						// 0xFX65 Reads X + 1 bytes at I
+						case 0x0065:
+							reuses_index |= index_stale;
+							branch.index_known = 0;
+							index_stale = 1;
+						break;
+						default:;
+					}
+				break;
+				default:;
+			}
+		}
+	}
+
+	// Flag the writes landing on code, only writes where I is known can be checked
+	for (const Write & write : writes) {
+		for (byte_iterator = write.start; byte_iterator < write.start + write.length && byte_iterator < MEMORY_SIZE; byte_iterator++) {
+			if (result->map[byte_iterator] == ROM_BYTE_CODE) {
+				result->self_modifying.push_back(write.instruction);
+				break;
+			}
+		}
+	}
+
+	// Count what was found
+	result->code_bytes = 0;
+	result->data_bytes = 0;
+	for (byte_iterator = 0; byte_iterator < MEMORY_SIZE; byte_iterator++) {
+		result->code_bytes += result->map[byte_iterator] == ROM_BYTE_CODE;
+		result->data_bytes += result->map[byte_iterator] == ROM_BYTE_DATA;
+		if (result->map[byte_iterator] == ROM_BYTE_CODE) {
+			result->code_pages[byte_iterator / MEMORY_PAGE_SIZE] = 1;
+		}
+	}
+
+	// Each quirk only leaves the default on its own evidence. SUPER-CHIP instructions mean the
+	// program was written for CHIP-48 behaviours, where shifts ignore VY and I is left unchanged.
+	result->quirks = QUIRKS_DEFAULT;
+	result->quirks.shift_vy = shifts_vy && ! uses_schip;
+	// Carrying on from where a load or store left I needs I to move past the last register
+	result->quirks.load_store_index = reuses_index || ! uses_schip;
+	result->quirks.jump_vx = uses_schip;
+	// Nothing in the code shows a program relying on VF after 0x8XY1/0x8XY2/0x8XY3, so
+	// logic_reset_vf keeps the default
+	if (uses_schip) {
+		result->profile = "CHIP-48";
+	} else if (result->quirks.shift_vy) {
+		result->profile = "COSMAC VIP";
+	} else {
+		result->profile = "default";
+	}
+}
+
+// Marks a range of memory with a kind, code takes priority over data
+void ROMAnalyzer::mark(ROMAnalysis * result, int start, int length, uint8_t kind) {
+	int byte_iterator;
+
+	for (byte_iterator = start; byte_iterator < start + length && byte_iterator < MEMORY_SIZE; byte_iterator++) {
+		if (result->map[byte_iterator] != ROM_BYTE_CODE) {
+			result->map[byte_iterator] = kind;
+		}
+	}
+}
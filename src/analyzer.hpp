@@ -0,0 +1,70 @@
+#ifndef _H_ANALYZER
+#define _H_ANALYZER
+
+#include <cstdint>
+#include <vector>
+
+#include "chip8.hpp"
+
+// What a byte of memory was found to hold
+#define ROM_BYTE_UNKNOWN 0
+#define ROM_BYTE_CODE    1
+#define ROM_BYTE_DATA    2
+
+/* Map of a program built without running it */
+struct ROMAnalysis {
+	/* What each byte of memory holds, one of ROM_BYTE_* */
+	uint8_t map[MEMORY_SIZE];
+	/* Set for each memory page holding any code */
+	uint8_t code_pages[MEMORY_PAGES];
+	/* Addresses of 0xFX33/0xFX55 instructions that write over code */
+	std::vector<uint16_t> self_modifying;
+	/* Number of bytes found to be code */
+	int code_bytes;
+	/* Number of bytes found to be sprite data */
+	int data_bytes;
+	/* Interpreter behaviours the program appears to rely on */
+	CHIP8Quirks quirks;
+	/* Name of the interpreter the quirks point to, "default" when nothing points away from the default */
+	const char * profile;
+};
+
+class ROMAnalyzer {
+public:
+	/*******************************
+	* Walks the control flow of a program from PROGRAM_START, following jumps,
+	* calls and skips, to separate code from sprite data, find writes that may
+	* modify code and infer the interpreter the program was written for.
+	* Jumps through 0xBNNN are only followed to NNN as the register is not known.
+	* @param program Bytes of the program
+	* @param length  Number of bytes in the program
+	* @param result  Analysis to store the results in
+	*******************************/
+	static void analyze(const uint8_t * program, int length, ROMAnalysis * result);
+
+private:
+	/* An address still to be walked, with the value of I on arrival if it is known */
+	struct Branch {
+		uint16_t address;
+		uint8_t  index_known;
+		uint16_t index;
+	};
+
+	/* A write to memory at a known location */
+	struct Write {
+		uint16_t instruction;
+		uint16_t start;
+		uint8_t  length;
+	};
+
+	/*******************************
+	* Marks a range of memory with a kind, code takes priority over data
+	* @param result Analysis to mark
+	* @param start  First address to mark
+	* @param length Number of bytes to mark
+	* @param kind   One of ROM_BYTE_*
+	*******************************/
+	static void mark(ROMAnalysis * result, int start, int length, uint8_t kind);
+};
+
+#endif
@@ -0,0 +1,84 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "libchip8.h"
+
+// Number of calls timed for each measurement
+#define BENCH_CALLS 1000000
+
+/*******************
+* Gets the current time in nanoseconds
+*******************/
+static double now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char * argv[]) {
+	FILE * rom_file;
+	uint8_t rom[4096];
+	size_t rom_length;
+	chip8_t * emulator;
+	chip8_state_t state;
+	const uint8_t * framebuffer;
+	double start;
+	int call_iterator;
+
+	// Check to ensure a program to run has been passed in
+	if (argc != 2) {
+		printf("Proper Usage:\n    chip8-bench <path_to_program>\n");
+		return 0;
+	}
+	rom_file = fopen(argv[1], "rb");
+	if (rom_file == NULL) {
+		printf("Could not open %s\n", argv[1]);
+		return 1;
+	}
+	rom_length = fread(rom, 1, sizeof(rom), rom_file);
+	fclose(rom_file);
+
+	emulator = chip8_create();
+	if (emulator == NULL || chip8_load_rom(emulator, rom, rom_length) != 0) {
+		printf("Could not load %s\n", argv[1]);
+		return 1;
+	}
+
+	// One cycle per call shows the cost of crossing the C interface
+	start = now_ns();
+	for (call_iterator = 0; call_iterator < BENCH_CALLS; call_iterator++) {
+		chip8_step(emulator, 1);
+	}
+	printf("chip8_step(1):       %8.2f ns/call\n", (now_ns() - start) / BENCH_CALLS);
+
+	// One call for all cycles shows the cost of the cycles alone
+	start = now_ns();
+	chip8_step(emulator, BENCH_CALLS);
+	printf("chip8_step(%d): %8.2f ns/cycle\n", BENCH_CALLS, (now_ns() - start) / BENCH_CALLS);
+
+	start = now_ns();
+	for (call_iterator = 0; call_iterator < BENCH_CALLS; call_iterator++) {
+		chip8_set_keys(emulator, (uint16_t) call_iterator);
+	}
+	printf("chip8_set_keys:      %8.2f ns/call\n", (now_ns() - start) / BENCH_CALLS);
+
+	start = now_ns();
+	for (call_iterator = 0; call_iterator < BENCH_CALLS; call_iterator++) {
+		framebuffer = chip8_framebuffer(emulator);
+	}
+	printf("chip8_framebuffer:   %8.2f ns/call (first pixel %d)\n", (now_ns() - start) / BENCH_CALLS, framebuffer[0] >> 7);
+
+	start = now_ns();
+	for (call_iterator = 0; call_iterator < BENCH_CALLS / 100; call_iterator++) {
+		chip8_get_state(emulator, &state);
+		chip8_set_state(emulator, &state);
+	}
+	printf("chip8_get/set_state: %8.2f ns/pair\n", (now_ns() - start) / (BENCH_CALLS / 100));
+
+	chip8_destroy(emulator);
+	return 0;
+}
@@ -1,55 +1,379 @@
 #include "chip8.hpp"
+#include "rom_cache.hpp"
+
+// Machine state of a freshly reset CHIP-8, restored by reset and restart with a single copy
+static constexpr CHIP8Machine pristine_machine = CHIP8Machine();
 
 CHIP8::CHIP8() {
+	// Seed the random number generator, xorshift must not be seeded with 0
+	this->random_state = (uint32_t) time(NULL) ^ (uint32_t) (uintptr_t) this;
+	this->random_state |= 1;
 	this->reset();
 }
 
+// Drops a reference to a page table, freeing it and releasing its pages with the last reference
+void PagedMemory::release(PageTable * table) {
+	int page_iterator;
+
+	if (table == nullptr || table->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+	for (page_iterator = 0; page_iterator < MEMORY_PAGES; page_iterator++) {
+		PagedMemory::release(table->pages[page_iterator]);
+	}
+	delete table;
+}
+
+// Drops a reference to a page, freeing it with the last reference
+void PagedMemory::release(MemoryPage * page) {
+	if (page->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete page;
+	}
+}
+
+// Copies the page table if it is shared, so its pages can be replaced
+void PagedMemory::unshareTable() {
+	PageTable * copy;
+	int page_iterator;
+
+	if (this->table->references.load(std::memory_order_acquire) == 1) {
+		return;
+	}
+	copy = new PageTable();
+	copy->references.store(1, std::memory_order_relaxed);
+	for (page_iterator = 0; page_iterator < MEMORY_PAGES; page_iterator++) {
+		copy->pages[page_iterator] = this->table->pages[page_iterator];
+		copy->pages[page_iterator]->references.fetch_add(1, std::memory_order_relaxed);
+	}
+	PagedMemory::release(this->table);
+	this->table = copy;
+}
+
+// Copies a page and the page table if either is shared, so the page can be written
+MemoryPage * PagedMemory::unsharePage(int number) {
+	MemoryPage * copy;
+
+	this->unshareTable();
+	if (this->table->pages[number]->references.load(std::memory_order_acquire) == 1) {
+		return this->table->pages[number];
+	}
+	copy = new MemoryPage();
+	copy->references.store(1, std::memory_order_relaxed);
+	memcpy(copy->bytes, this->table->pages[number]->bytes, MEMORY_PAGE_SIZE);
+	PagedMemory::release(this->table->pages[number]);
+	this->table->pages[number] = copy;
+	return copy;
+}
+
+// Shares a page from another memory in place of one of the pages of this memory
+void PagedMemory::sharePage(int number, const PagedMemory & source) {
+	MemoryPage * page = source.table->pages[number];
+
+	if (this->table->pages[number] == page) {
+		return;
+	}
+	this->unshareTable();
+	page->references.fetch_add(1, std::memory_order_relaxed);
+	PagedMemory::release(this->table->pages[number]);
+	this->table->pages[number] = page;
+}
+
+// Makes this memory hold the same bytes as another memory without giving up its own table.
+void PagedMemory::refill(const PagedMemory & source) {
+	MemoryPage * page;
+	int page_iterator;
+
+	// Take a table of its own once, later refills reuse it
+	if (this->table == nullptr || this->table->references.load(std::memory_order_acquire) != 1) {
+		*this = source;
+		this->unshareTable();
+		return;
+	}
+	for (page_iterator = 0; page_iterator < MEMORY_PAGES; page_iterator++) {
+		page = this->table->pages[page_iterator];
+		if (page == source.table->pages[page_iterator]) {
+			// Already shared with the source
+		} else if (page->references.load(std::memory_order_acquire) == 1) {
+			// Keep the page this memory wrote so the next write to it does not allocate
+			memcpy(page->bytes, source.table->pages[page_iterator]->bytes, MEMORY_PAGE_SIZE);
+		} else {
+			source.table->pages[page_iterator]->references.fetch_add(1, std::memory_order_relaxed);
+			PagedMemory::release(page);
+			this->table->pages[page_iterator] = source.table->pages[page_iterator];
+		}
+	}
+}
+
+// Replaces a page with a new page holding the bytes, the rest of the page is zeroed
+void PagedMemory::loadPage(int number, const uint8_t * bytes, int length) {
+	MemoryPage * page;
+
+	this->unshareTable();
+	page = new MemoryPage();
+	page->references.store(1, std::memory_order_relaxed);
+	memcpy(page->bytes, bytes, length);
+	PagedMemory::release(this->table->pages[number]);
+	this->table->pages[number] = page;
+}
+
+// Creates a memory where every page is a zeroed page shared between them
+PagedMemory PagedMemory::zeroed() {
+	PagedMemory memory;
+	MemoryPage * page;
+	int page_iterator;
+
+	page = new MemoryPage();
+	page->references.store(MEMORY_PAGES, std::memory_order_relaxed);
+	memory.table = new PageTable();
+	memory.table->references.store(1, std::memory_order_relaxed);
+	for (page_iterator = 0; page_iterator < MEMORY_PAGES; page_iterator++) {
+		memory.table->pages[page_iterator] = page;
+	}
+	return memory;
+}
+
+// Builds the memory of a freshly reset CHIP-8, holding the font set at 0x000
+static PagedMemory buildPristineMemory() {
+	PagedMemory memory;
+
+	// Every empty page shares the same zeroed memory until it is written
+	memory = PagedMemory::zeroed();
+	memory.loadPage(0, chip8_fontset, CHIP8_FONTSET_SIZE);
+	return memory;
+}
+
+// Gets the memory of a freshly reset CHIP-8.
+const PagedMemory & CHIP8::pristineMemory() {
+	static const PagedMemory memory = buildPristineMemory();
+	return memory;
+}
+
 // Loads a file into memory for emulation.
-void CHIP8::loadProgram(std::string file_path) {
-	std::streampos start;
-	std::streampos end;
-	int file_length;
-	int bytes_read;
-	uint8_t * location_start;
-	char * write_pointer;
-
-	std::ifstream file_input (file_path.c_str(), std::ios::binary);
-	// Find start location of file
-	file_input.seekg(0, file_input.end);
-	file_length = file_input.tellg();
-	file_input.seekg(0, file_input.beg);
-	// Ensure the file is the correct size
-	if (file_length > (MEMORY_SIZE - PROGRAM_START)) {
-		std::cout << "File " << file_path << " (" << file_length << ") larger than avaiable CHIP8 memory (" 
-		<< MEMORY_SIZE - PROGRAM_START << ")" << std::endl;
+uint8_t CHIP8::loadProgram(std::string file_path) {
+	std::shared_ptr<const ROMImage> image;
+
+	image = ROMCache::load(file_path);
+	if (image == nullptr) {
+		return 0;
+	}
+	this->loadProgram(image);
+	return 1;
+}
+
+// Loads a program from a buffer into memory for emulation.
+uint8_t CHIP8::loadProgram(const uint8_t * program, int length) {
+	std::shared_ptr<const ROMImage> image;
+
+	image = ROMCache::load(program, length);
+	if (image == nullptr) {
+		return 0;
+	}
+	this->loadProgram(image);
+	return 1;
+}
+
+// Loads a cached program image into memory for emulation and picks its quirks.
+void CHIP8::loadProgram(std::shared_ptr<const ROMImage> image) {
+	int page_iterator;
+
+	// Use the behaviours the program was found to rely on
+	this->quirks = image->analysis.quirks;
+	// Share the programs pages, they are copied if the program writes to them
+	for (page_iterator = PROGRAM_START / MEMORY_PAGE_SIZE; page_iterator < image->pageEnd(); page_iterator++) {
+		this->memory.sharePage(page_iterator, image->memory);
+	}
+	this->program_memory = image->memory;
+}
+
+// Resets the emulator and reloads the program last loaded
+void CHIP8::restart() {
+	if (this->program_memory.isEmpty()) {
+		this->reset();
 		return;
 	}
-	// Read the file into CHIP8 memory
-	write_pointer = (char *) &(this->memory[PROGRAM_START]);
-	file_input.read(write_pointer, file_length);
+	// The cached image already holds the whole memory after a reset and load
+	*static_cast<CHIP8Machine *>(this) = pristine_machine;
+	this->memory.refill(this->program_memory);
+}
+
+// Copies the machine state into a snapshot
+void CHIP8::saveState(CHIP8State * state) const {
+	int address_iterator;
+
+	state->opcode = this->opcode;
+	state->index = this->index;
+	state->program_counter = this->program_counter;
+	memcpy(state->registers, this->registers, sizeof(state->registers));
+	state->timer_delay = this->timer_delay;
+	state->timer_sound = this->timer_sound;
+	memcpy(state->stack, this->stack, sizeof(state->stack));
+	state->stack_pointer = this->stack_pointer;
+	for (address_iterator = 0; address_iterator < MEMORY_PAGES; address_iterator++) {
+		memcpy(&state->memory[address_iterator * MEMORY_PAGE_SIZE], this->memory.page(address_iterator), MEMORY_PAGE_SIZE);
+	}
+	memcpy(state->display, this->display, sizeof(state->display));
+	state->random_state = this->random_state;
+	state->fault_flag = this->faultFlag;
+	state->quirks = this->quirks;
+#ifdef CHIP8_VIP_TIMING
+	state->machine_cycles = this->machine_cycles;
+	state->frame_cycles = this->frame_cycles;
+#else
+	state->machine_cycles = 0;
+	state->frame_cycles = 0;
+#endif
+}
+
+// Restores the machine state from a snapshot
+void CHIP8::loadState(const CHIP8State * state) {
+	int address_iterator;
+
+	this->opcode = state->opcode;
+	this->index = state->index;
+	this->program_counter = state->program_counter;
+	memcpy(this->registers, state->registers, sizeof(this->registers));
+	this->timer_delay = state->timer_delay;
+	this->timer_sound = state->timer_sound;
+	memcpy(this->stack, state->stack, sizeof(this->stack));
+	this->stack_pointer = state->stack_pointer & STACK_POINTER_MASK;
+	// Only write the pages that differ so unchanged pages stay shared
+	for (address_iterator = 0; address_iterator < MEMORY_PAGES; address_iterator++) {
+		if (memcmp(this->memory.page(address_iterator), &state->memory[address_iterator * MEMORY_PAGE_SIZE], MEMORY_PAGE_SIZE) != 0) {
+			this->memory.loadPage(address_iterator, &state->memory[address_iterator * MEMORY_PAGE_SIZE], MEMORY_PAGE_SIZE);
+		}
+	}
+	memcpy(this->display, state->display, sizeof(this->display));
+	// xorshift must not be seeded with 0, a zeroed snapshot still gets a working generator
+	this->random_state = state->random_state != 0 ? state->random_state : 1;
+	this->faultFlag = state->fault_flag;
+	this->quirks = state->quirks;
+#ifdef CHIP8_VIP_TIMING
+	this->machine_cycles = state->machine_cycles;
+	this->frame_cycles = state->frame_cycles;
+#endif
+	this->drawFlag = 1;
+}
+
+// Sets the interpreter behaviours the emulator follows
+void CHIP8::setQuirks(CHIP8Quirks quirks) {
+	this->quirks = quirks;
+}
+
+// Creates a child emulator in the same state as this one.
+CHIP8 CHIP8::fork() const {
+	// Copying shares the memory page table, it is only copied when memory is written
+	return CHIP8(*this);
 }
 
 // Preforms a cycle on the chip
 void CHIP8::cycle() {
+#ifdef CHIP8_VIP_TIMING
+	uint16_t instruction_address = this->program_counter;
+	uint8_t vx;
+#endif
 	// Fetch opcode from memory
-	this->opcode = BIT8TO16(memory[this->program_counter],memory[this->program_counter + 1])
+	this->opcode = BIT8TO16(this->readMemory(this->program_counter), this->readMemory(this->program_counter + 1))
 
+#ifdef CHIP8_VIP_TIMING
+	// Some costs depend on VX, which the opcode may overwrite (0xDFYN sets the collision flag)
+	vx = this->registers[(this->opcode & 0x0F00) >> 8];
+#endif
 	// Execute the opcode
 	this->executeOpcode();
-	
-	// Update delay timer
-	if (this->timer_delay > 0) {
-		this->timer_delay--;
+
+#ifdef CHIP8_VIP_TIMING
+	// Timers tick on frame boundaries
+	this->advanceCycles(this->opcodeCycles(instruction_address, vx));
+#else
+	// Timers tick once per cycle
+	this->updateTimers();
+#endif
+}
+
+#ifdef CHIP8_VIP_TIMING
+// Advances emulated time, ticking the timers at each frame boundary passed
+void CHIP8::advanceCycles(uint32_t cycles) {
+	this->machine_cycles += cycles;
+	this->frame_cycles += cycles;
+	while (this->frame_cycles >= VIP_CYCLES_PER_FRAME) {
+		this->frame_cycles -= VIP_CYCLES_PER_FRAME;
+		// The display interrupt counts down the timers, then the display DMA takes its share of the frame
+		this->updateTimers();
+		this->machine_cycles += VIP_CYCLES_DISPLAY_DMA;
+		this->frame_cycles += VIP_CYCLES_DISPLAY_DMA;
 	}
-	// Update sound timer
-	if (this->timer_sound > 0) {
-		// Beep at 0
-		if (this->timer_sound == 1) {
-			this->beepFlag = 1;
-		}
-		this->timer_sound--;
+}
+
+// Gets the machine cycles the COSMAC VIP took to run the opcode just executed.
+// Costs follow the routines of the original VIP interpreter, with skips costing extra when taken.
+uint32_t CHIP8::opcodeCycles(uint16_t instruction_address, uint8_t vx) const {
+	uint32_t skipped;
+	uint32_t value;
+	uint32_t rows;
+
+	// Skips move the program counter past the next instruction
+	skipped = this->program_counter == (uint16_t) (instruction_address + 4) ? 4 : 0;
+
+	switch (this->opcode & 0xF000) {
+		case 0x0000:
+			// 0x00E0 clears the 256 display bytes, 12 cycles each
+			if (this->opcode == 0x00E0) {
+				return VIP_CYCLES_FETCH + 24 + 256 * 12;
+			}
+			// 0x00EE pops the return address
+			return VIP_CYCLES_FETCH + 10;
+		case 0x1000:
+			return VIP_CYCLES_FETCH + 12;
+		case 0x2000:
+			return VIP_CYCLES_FETCH + 26;
+		case 0x3000:
+		case 0x4000:
+			return VIP_CYCLES_FETCH + 10 + skipped;
+		case 0x5000:
+		case 0x9000:
+			return VIP_CYCLES_FETCH + 14 + skipped;
+		case 0x6000:
+			return VIP_CYCLES_FETCH + 6;
+		case 0x7000:
+			return VIP_CYCLES_FETCH + 10;
+		// 0x8XYN runs the ALU op from a small routine built in RAM
+		case 0x8000:
+			return VIP_CYCLES_FETCH + 44;
+		case 0xA000:
+			return VIP_CYCLES_FETCH + 12;
+		case 0xB000:
+			return VIP_CYCLES_FETCH + 22;
+		case 0xC000:
+			return VIP_CYCLES_FETCH + 36;
+		// 0xDXYN waits for the display interrupt, then each row costs more when it straddles two bytes
+		case 0xD000:
+			rows = this->opcode & 0x000F;
+			value = (vx % 8) ? 68 : 46;
+			return VIP_CYCLES_FETCH + (VIP_CYCLES_PER_FRAME - this->frame_cycles) + 26 + rows * value;
+		case 0xE000:
+			return VIP_CYCLES_FETCH + 14 + skipped;
+		case 0xF000:
+			switch (this->opcode & 0x00FF) {
+				// 0xFX1E and 0xFX29 do 16 bit arithmetic on I
+				case 0x001E:
+				case 0x0029:
+					return VIP_CYCLES_FETCH + 16;
+				// 0xFX33 counts down each decimal digit by repeated subtraction
+				case 0x0033:
+					value = vx;
+					return VIP_CYCLES_FETCH + 80 + 16 * (value / 100 + (value / 10) % 10 + value % 10);
+				// 0xFX55 and 0xFX65 copy one register per loop
+				case 0x0055:
+				case 0x0065:
+					return VIP_CYCLES_FETCH + 14 + 14 * (((this->opcode & 0x0F00) >> 8) + 1);
+				default:
+					return VIP_CYCLES_FETCH + 10;
+			}
+		default:
+			return VIP_CYCLES_FETCH;
 	}
 }
+#endif
 
 // Executes the next opcode in memory
 void CHIP8::executeOpcode() {
@@ -60,6 +384,9 @@ void CHIP8::executeOpcode() {
 	int cell_offset;
 	uint8_t temporary_result;
 	int addition_result;
+	uint16_t sprite_row;
+	uint8_t sprite_pixels;
+	uint8_t * display_byte;
 
 	// Check first digit of opcode (35 possible opcodes)
 	switch (this->opcode & 0xF000) {
@@ -69,14 +396,17 @@ void CHIP8::executeOpcode() {
 			switch (this->opcode & 0x000F) {
 				// 0x00E0: Clears the screen
 				case 0x0000:
-					memset(this->display, 0, GRAPHICS_SIZE * sizeof(this->display[0]));
+					memset(this->display, 0, sizeof(this->display));
 					this->drawFlag = 1;
 					this->program_counter += 2;
 				break;
 				// 0x00EE: Returns from subroutine
 				case 0x000E:
-					// Get stored return address and increment pc, decrement stack pointer from escaped frame
-					this->program_counter = this->stack[--(this->stack_pointer)] + 2;
+					// Get stored return address and increment pc, decrement stack pointer from escaped frame.
+					// Popping an empty stack wraps the pointer past the stack, raising the fault
+					this->stack_pointer = CHIP8_MASK(this->stack_pointer - 1, STACK_POINTER_MASK);
+					this->faultFlag |= this->stack_pointer >= STACK_SIZE;
+					this->program_counter = this->stack[CHIP8_MASK(this->stack_pointer, STACK_SIZE - 1)] + 2;
 				break;
 				// 0x0000 Unimplemented
 				default:;
@@ -88,8 +418,10 @@ void CHIP8::executeOpcode() {
 		break;
 		// 0x2NNN Calls subroutine at NNN
 		case 0x2000:
-			// Store address in stack
-			this->stack[(this->stack_pointer)++] = this->program_counter;
+			// Store address in stack, pushing onto a full stack raises the fault and overwrites a frame
+			this->faultFlag |= this->stack_pointer >= STACK_SIZE;
+			this->stack[CHIP8_MASK(this->stack_pointer, STACK_SIZE - 1)] = this->program_counter;
+			this->stack_pointer = CHIP8_MASK(this->stack_pointer + 1, STACK_POINTER_MASK);
 			// Execute subroutine at 0x_NNN
 			this->program_counter = this->opcode & 0x0FFF;
 		break;
@@ -127,16 +459,25 @@ void CHIP8::executeOpcode() {
 				// 0x8XY1 Sets VX to VX or VY
 				case 0x0001:
 					this->registers[(this->opcode & 0x0F00) >> 8] |= this->registers[(this->opcode & 0x00F0) >> 4];
+					if (this->quirks.logic_reset_vf) {
+						this->registers[0xF] = 0;
+					}
 					this->program_counter += 2;
 				break;
 				// 0x8XY2 Sets VX to VX and VY
 				case 0x0002:
 					this->registers[(this->opcode & 0x0F00) >> 8] &= this->registers[(this->opcode & 0x00F0) >> 4];
+					if (this->quirks.logic_reset_vf) {
+						this->registers[0xF] = 0;
+					}
 					this->program_counter += 2;
 				break;
 				// 0x8XY3 Sets VX to VX xor VY
 				case 0x0003:
 					this->registers[(this->opcode & 0x0F00) >> 8] ^= this->registers[(this->opcode & 0x00F0) >> 4];
+					if (this->quirks.logic_reset_vf) {
+						this->registers[0xF] = 0;
+					}
 					this->program_counter += 2;
 				break;
 				// 0x8XY4 Adds VY to VX. VF is set to 1 when there is a carry and 0 when there isn't
@@ -159,8 +500,13 @@ void CHIP8::executeOpcode() {
 				break;
 				// 0x8XY6 Shifts VX right by 1. VF is set to the value of the least significant bit of VX before the shift
 				case 0x0006:
-					this->registers[0XF] = this->registers[(this->opcode & 0x0F00) >> 8] & 0x1;
+					// The COSMAC VIP shifts VY into VX
+					if (this->quirks.shift_vy) {
+						this->registers[(this->opcode & 0x0F00) >> 8] = this->registers[(this->opcode & 0x00F0) >> 4];
+					}
+					temporary_result = this->registers[(this->opcode & 0x0F00) >> 8] & 0x1;
 					this->registers[(this->opcode & 0x0F00) >> 8] >>= 1;
+					this->registers[0XF] = temporary_result;
 					this->program_counter += 2;
 				break;
 				// 0x8XY7 Sets VX to VY minus VX. VF is set to 0 when there is a borrow, and 1 when there isn't
@@ -176,8 +522,13 @@ void CHIP8::executeOpcode() {
 				break;
 				// 0x8XYE Shifts VX to the left by 1. VF is set to the value of the most significant bit of VX before the shift
 				case 0x000E:
-					this->registers[0xF] = this->registers[(this->opcode & 0x0F00) >> 8] >> 7;
+					// The COSMAC VIP shifts VY into VX
+					if (this->quirks.shift_vy) {
+						this->registers[(this->opcode & 0x0F00) >> 8] = this->registers[(this->opcode & 0x00F0) >> 4];
+					}
+					temporary_result = this->registers[(this->opcode & 0x0F00) >> 8] >> 7;
 					this->registers[(this->opcode & 0x0F00) >> 8] <<= 1;
+					this->registers[0xF] = temporary_result;
 					this->program_counter += 2;
 				break;
 				// 0x8000 Unimplemented
@@ -195,11 +546,16 @@ void CHIP8::executeOpcode() {
 		break;
 		// 0xBNNN Jumps to the address NNN plus V0
 		case 0xB000:
+			// CHIP-48 jumps to XNN plus VX
+			if (this->quirks.jump_vx) {
+				this->program_counter = this->registers[(this->opcode & 0x0F00) >> 8] + (this->opcode & 0x0FFF);
+				break;
+			}
 			this->program_counter = this->registers[0] + (this->opcode & 0x0FFF);
 		break;
 		// 0xCXNN Sets VX to the result fo a bitwise and operation on a random number and NN
 		case 0xC000:
-			this->registers[(this->opcode & 0x0F00) >> 8] = (this->opcode & 0x00FF) & (rand() % 0xFF);
+			this->registers[(this->opcode & 0x0F00) >> 8] = (this->opcode & 0x00FF) & this->nextRandom();
 			this->program_counter += 2;
 		break;
 		// 0xDXYN Draws a sprite at coordinate (VX, VY) that has a width of 8 pixels and a height of 
@@ -210,22 +566,25 @@ void CHIP8::executeOpcode() {
 		case 0xD000:
 			// Initially assume there is no flipped bit
 			this->registers[0xF] = 0;
+			// The sprite starts at (VX, VY) wrapped onto the display, the rows and pixels past the edges are clipped
+			row_offset = this->registers[(this->opcode & 0x00F0) >> 4] % GRAPHICS_HEIGHT;
+			cell_offset = this->registers[(this->opcode & 0x0F00) >> 8] % GRAPHICS_WIDTH;
 			// Hit each line in the sprite
-			for (row_iterator = 0; row_iterator < (this->opcode & 0x000F); row_iterator++) {
-				// Hit each pixel in the line
-				for (cell_iterator = 0; cell_iterator < 8; cell_iterator++) {
-					// If the pixel is not set continue to the next pixel
-					if ((this->memory[this->index + row_iterator] & (0x80 >> cell_iterator)) == 0) {
-						continue;
-					}
-					row_offset = (this->registers[(this->opcode & 0x00F0) >> 4] + row_iterator) * GRAPHICS_WIDTH;
-					cell_offset = row_offset + this->registers[(this->opcode & 0x0F00) >> 8] + cell_iterator;
-					// Flip the pixel in the display
-					this->display[cell_offset] ^= 1;
+			for (row_iterator = 0; row_iterator < (this->opcode & 0x000F) && row_offset + row_iterator < GRAPHICS_HEIGHT; row_iterator++) {
+				screen_iterator = (row_offset + row_iterator) * GRAPHICS_ROW_BYTES + cell_offset / 8;
+				// The line covers two display bytes unless VX is a multiple of 8
+				sprite_row = this->readMemory(this->index + row_iterator) << (8 - cell_offset % 8);
+				// Hit each display byte the line covers, clipping the second at the right edge
+				for (cell_iterator = 0; cell_iterator < 2 && cell_offset / 8 + cell_iterator < GRAPHICS_ROW_BYTES; cell_iterator++) {
+					sprite_pixels = sprite_row >> (8 * (1 - cell_iterator));
+					// The loop bounds keep the byte on the display, the mask only guards them
+					display_byte = &this->display[(screen_iterator + cell_iterator) & (sizeof(this->display) - 1)];
 					// Check if the flipped flag needs to be set
-					if (this->display[cell_offset] == 1) {
+					if (~*display_byte & sprite_pixels) {
 						this->registers[0xF] = 1;
 					}
+					// Flip the pixels in the display
+					*display_byte ^= sprite_pixels;
 				}
 			}
 			this->drawFlag = 1;
@@ -237,11 +596,11 @@ void CHIP8::executeOpcode() {
 			switch (this->opcode & 0x00FF) {
 				// 0xEX9E Skips the next instruction if the key stored in VX is pressed
 				case 0x009E:
-					this->program_counter += this->keypad[this->registers[(this->opcode & 0x0F00) >> 8]] ? 4 : 2;
+					this->program_counter += this->keypad[CHIP8_MASK(this->registers[(this->opcode & 0x0F00) >> 8], KEYPAD_SIZE - 1)] ? 4 : 2;
 				break;
 				// 0xEX9E Skips the next instruction if the key stored in VX is not pressed
 				case 0x00A1:
-					this->program_counter += this->keypad[this->registers[(this->opcode & 0x0F00) >> 8]] ? 2 : 4;
+					this->program_counter += this->keypad[CHIP8_MASK(this->registers[(this->opcode & 0x0F00) >> 8], KEYPAD_SIZE - 1)] ? 2 : 4;
 				break;
 				// 0xE000 Unimplemented
 				default:;
@@ -289,7 +648,7 @@ void CHIP8::executeOpcode() {
 					addition_result = this->index + this->registers[(this->opcode & 0x0F00) >> 8];
 					// Check for overflow
 					this->registers[0xF] = addition_result > 0xFFF ? 1 : 0;
-					this->index = addition_result % 0xFFF;
+					this->index = addition_result & MEMORY_MASK;
 					this->program_counter += 2;
 				break;
 				// 0xFX29 Sets I to the location of the sprite for the character in VX.
@@ -304,31 +663,35 @@ void CHIP8::executeOpcode() {
 				// location in I, the tens digit at location I+1, and the ones digit at location I+2.)
 				case 0x0033:
 					temporary_result = this->registers[(this->opcode & 0x0F00) >> 8];
-					this->memory[this->index] = temporary_result / 100;
-					this->memory[this->index + 1] = (temporary_result % 100) / 10;
-					this->memory[this->index + 2] = temporary_result % 10;
+					this->writeMemory(this->index, temporary_result / 100);
+					this->writeMemory(this->index + 1, (temporary_result % 100) / 10);
+					this->writeMemory(this->index + 2, temporary_result % 10);
 					this->program_counter += 2;
 				break;
 				// 0xFX55 Stores V0 to VX (including VX) in memory starting at address I
 				case 0x0055:
 					temporary_result = (this->opcode & 0x0F00) >> 8;
 					// Iterate over the registers
-					for (cell_iterator = 0; cell_iterator < temporary_result; cell_iterator++) {
-						this->memory[this->index + cell_iterator] = this->registers[cell_iterator];
+					for (cell_iterator = 0; cell_iterator <= temporary_result; cell_iterator++) {
+						this->writeMemory(this->index + cell_iterator, this->registers[cell_iterator]);
 					}
 					// Incerase the index
-					this->index += temporary_result + 1;
+					if (this->quirks.load_store_index) {
+						this->index += temporary_result + 1;
+					}
 					this->program_counter += 2;
 				break;
 				// 0xFX65 Fills V0 to VX (including VX) with values from memory starting from address I
 				case 0x0065:
 					temporary_result = (this->opcode & 0x0F00) >> 8;
 					// Iterate over the registers
-					for (cell_iterator = 0; cell_iterator < temporary_result; cell_iterator++) {
-						this->registers[cell_iterator] = this->memory[this->index + cell_iterator];
+					for (cell_iterator = 0; cell_iterator <= temporary_result; cell_iterator++) {
+						this->registers[cell_iterator] = this->readMemory(this->index + cell_iterator);
 					}
 					// Incerase the index
-					this->index += temporary_result + 1;
+					if (this->quirks.load_store_index) {
+						this->index += temporary_result + 1;
+					}
 					this->program_counter += 2;
 				break;
 				// 0xFX00 not implemented
@@ -341,40 +704,10 @@ void CHIP8::executeOpcode() {
 
 }
 
+// Resets the emulator to a clean state
 void CHIP8::reset() {
-	int memory_iterator;
-	int register_iterator;
-	int key_iterator;
-	int display_iterator;
-	int stack_iterator;
-	int fontset_iterator;
-
-	srand(time(NULL));
-
-	this->timer_delay = 0;
-	this->timer_sound = 0;
-
-	this->program_counter = PROGRAM_START;
-	this->opcode = 0;
-	this->index = 0;
-	this->stack_pointer = 0;
-
-	// Set memory to empty
-	memset(this->memory, 0, MEMORY_SIZE * sizeof(this->memory[0]));
-	// Set registers to empty
-	memset(this->registers, 0, NUM_REGISTERS * sizeof(this->registers[0]));
-	// Clear keypresses
-	memset(this->keypad, 0, KEYPAD_SIZE * sizeof(this->keypad[0]));
-	// Clear the display
-	memset(this->display, 0, GRAPHICS_SIZE * sizeof(this->display[0]));
-	// Clear the stack
-	memset(this->stack, 0, STACK_SIZE * sizeof(this->stack[0]));
-
-	//Load the fontset into memory
-	for (fontset_iterator = 0; fontset_iterator < CHIP8_FONTSET_SIZE; fontset_iterator++) {
-		this->memory[fontset_iterator] = chip8_fontset[fontset_iterator];
-	}
-
-	// Draw the blank screen
-	this->drawFlag = 1;
-}
\ No newline at end of file
+	// Restore the registers, stack, display and keypad with a single copy
+	*static_cast<CHIP8Machine *>(this) = pristine_machine;
+	// Share the pristine memory pages, keeping the pages this emulator wrote
+	this->memory.refill(CHIP8::pristineMemory());
+}
@@ -1,8 +1,12 @@
 #ifndef _H_CHIP8
 #define _H_CHIP8
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <cstdlib>
 #include <time.h>
@@ -19,52 +23,341 @@
 //   0x050-0x0A0 - Used for the built in 4x5 pixel font set (0-F)
 //   0x200-0xFFF - Program ROM and work RAM
 #define MEMORY_SIZE 4096
+// Every address is wrapped into memory with this mask, so no access can leave it
+#define MEMORY_MASK (MEMORY_SIZE - 1)
+// Memory is split into pages which forked emulators share until one of them writes to the page
+#define MEMORY_PAGE_SIZE 256
+#define MEMORY_PAGES (MEMORY_SIZE / MEMORY_PAGE_SIZE)
 // The graphics of the CHIP-8 are black and white and the screen has a total of 2048 pixels (64 x 32)
-// TODO: Replace where each pixel is a bit (a byte is 8 pixels in a row)
+// Each pixel is a bit, a byte is 8 pixels in a row with the leftmost pixel in the most significant bit
 #define GRAPHICS_WIDTH 64
 #define GRAPHICS_HEIGHT 32
 #define GRAPHICS_SIZE 64 * 32
+#define GRAPHICS_ROW_BYTES (GRAPHICS_WIDTH / 8)
 // The CHIP-8 spec defines a maximum stack depth of 16 frames.
 #define STACK_SIZE 16
+// The stack pointer is kept below twice the stack size, so it is past the stack only after an overflow or underflow
+#define STACK_POINTER_MASK (2 * STACK_SIZE - 1)
 // The CHIP-8 spec defines a hex based keypad (0x0-0xF).
 #define KEYPAD_SIZE 16
 // CHIP-8 spec says program starts at 0x200
 #define PROGRAM_START 0x200
+// Build with CHIP8_VIP_TIMING defined to charge each opcode the machine cycles it took on the
+// COSMAC VIP and tick the timers on emulated frame boundaries instead of once per cycle.
+#ifdef CHIP8_VIP_TIMING
+// The COSMAC VIP runs at 1.7609MHz with 8 clocks per machine cycle, 3668 machine cycles per 60Hz frame
+#define VIP_CYCLES_PER_FRAME 3668
+// Machine cycles taken from each frame by the display DMA (32 rows, each 8 bytes shown 4 times)
+#define VIP_CYCLES_DISPLAY_DMA 1024
+// Machine cycles the interpreter takes to fetch and decode each opcode
+#define VIP_CYCLES_FETCH 40
+#endif
+// Build with CHIP8_NO_MASKS defined to compile the memory, stack and keypad index masks out.
+// Such a build trusts every program to stay in bounds and only exists to measure what the masks cost.
+#ifdef CHIP8_NO_MASKS
+#define CHIP8_MASK(VALUE, MASK) (VALUE)
+#else
+#define CHIP8_MASK(VALUE, MASK) ((VALUE) & (MASK))
+#endif
 // Combines two 1 byte sequences into a 2 byte sequence
 #define BIT8TO16(A,B) ((A) << 8 | (B));
 
-class CHIP8 {
+/* A page of CHIP-8 memory, shared copy-on-write between page tables */
+struct MemoryPage {
+	/* Number of page tables holding the page */
+	std::atomic<uint32_t> references;
+	uint8_t bytes[MEMORY_PAGE_SIZE];
+};
+
+/* The pages making up CHIP-8 memory, shared copy-on-write between forked emulators */
+struct PageTable {
+	/* Number of emulators and images holding the table */
+	std::atomic<uint32_t> references;
+	MemoryPage * pages[MEMORY_PAGES];
+};
+
+/*
+* Copy-on-write CHIP-8 memory. Copying shares the whole page table with a single
+* reference count increment. The first write through a shared table copies the
+* table, and a write to a page still held by another table copies the page.
+* Copies may be used from different threads.
+*/
+class PagedMemory {
 private:
+	/* Pages of the memory, nullptr until pages are loaded */
+	PageTable * table;
+	/*******************************
+	* Drops a reference to a page table, freeing it and releasing its pages with the last reference
+	* @param table Table to release
+	*******************************/
+	static void release(PageTable * table);
+	/*******************************
+	* Drops a reference to a page, freeing it with the last reference
+	* @param page Page to release
+	*******************************/
+	static void release(MemoryPage * page);
+	/*******************************
+	* Copies the page table if it is shared, so its pages can be replaced
+	*******************************/
+	void unshareTable();
+	/*******************************
+	* Copies a page and the page table if either is shared, so the page can be written
+	* @param number Page to copy
+	* @return the page, only held by this memory
+	*******************************/
+	MemoryPage * unsharePage(int number);
+public:
+	/*******************************
+	* Creates a memory with no pages, pages must be loaded before it is read or written
+	*******************************/
+	PagedMemory() : table(nullptr) {}
+	PagedMemory(const PagedMemory & other) : table(other.table) {
+		if (this->table != nullptr) {
+			this->table->references.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	PagedMemory(PagedMemory && other) : table(other.table) {
+		other.table = nullptr;
+	}
+	PagedMemory & operator=(const PagedMemory & other) {
+		if (other.table != nullptr) {
+			other.table->references.fetch_add(1, std::memory_order_relaxed);
+		}
+		PagedMemory::release(this->table);
+		this->table = other.table;
+		return *this;
+	}
+	~PagedMemory() {
+		PagedMemory::release(this->table);
+	}
+	/*******************************
+	* Checks if the memory has no pages loaded
+	*******************************/
+	uint8_t isEmpty() const {
+		return this->table == nullptr;
+	}
+	/*******************************
+	* Reads a byte from memory
+	* @param address Memory location to read, inside memory
+	*******************************/
+	uint8_t read(uint16_t address) const {
+		return this->table->pages[address / MEMORY_PAGE_SIZE]->bytes[address % MEMORY_PAGE_SIZE];
+	}
+	/*******************************
+	* Writes a byte to memory, copying the page first if anything else can see it
+	* @param address Memory location to write, inside memory
+	* @param value   Byte to store at the location
+	*******************************/
+	void write(uint16_t address, uint8_t value) {
+		MemoryPage * page = this->table->pages[address / MEMORY_PAGE_SIZE];
+
+		if (this->table->references.load(std::memory_order_acquire) != 1 || page->references.load(std::memory_order_acquire) != 1) {
+			page = this->unsharePage(address / MEMORY_PAGE_SIZE);
+		}
+		page->bytes[address % MEMORY_PAGE_SIZE] = value;
+	}
+	/*******************************
+	* Gets the bytes of a page
+	* @param number Page to get
+	*******************************/
+	const uint8_t * page(int number) const {
+		return this->table->pages[number]->bytes;
+	}
+	/*******************************
+	* Shares a page from another memory in place of one of the pages of this memory
+	* @param number Page to replace
+	* @param source Memory holding the page to share
+	*******************************/
+	void sharePage(int number, const PagedMemory & source);
+	/*******************************
+	* Makes this memory hold the same bytes as another memory without giving up its own table.
+	* Pages only this memory holds are overwritten in place and every other page is shared
+	* from the source, so writes to pages written before stay on the fast path. The first
+	* refill of a memory that does not hold its own table allocates one.
+	* @param source Memory to copy the bytes of
+	*******************************/
+	void refill(const PagedMemory & source);
+	/*******************************
+	* Replaces a page with a new page holding the bytes, the rest of the page is zeroed
+	* @param number Page to replace
+	* @param bytes  Bytes to store at the start of the page
+	* @param length Number of bytes to store, at most MEMORY_PAGE_SIZE
+	*******************************/
+	void loadPage(int number, const uint8_t * bytes, int length);
+	/*******************************
+	* Creates a memory where every page is a zeroed page shared between them
+	*******************************/
+	static PagedMemory zeroed();
+};
+
+/* Behaviours that differ between CHIP-8 interpreters */
+struct CHIP8Quirks {
+	/* 0x8XY6/0x8XYE shift VY into VX (COSMAC VIP) instead of shifting VX in place */
+	uint8_t shift_vy;
+	/* 0xFX55/0xFX65 leave I past the last register (COSMAC VIP) instead of unchanged */
+	uint8_t load_store_index;
+	/* 0xBNNN jumps to XNN plus VX (CHIP-48) instead of NNN plus V0 */
+	uint8_t jump_vx;
+	/* 0x8XY1/0x8XY2/0x8XY3 reset VF (COSMAC VIP) */
+	uint8_t logic_reset_vf;
+};
+
+// Behaviours of the original COSMAC VIP interpreter
+#define QUIRKS_VIP (CHIP8Quirks { 1, 1, 0, 1 })
+// Behaviours of the CHIP-48 and SUPER-CHIP interpreters
+#define QUIRKS_CHIP48 (CHIP8Quirks { 0, 0, 1, 0 })
+// Behaviours of this emulator when nothing is known about the program
+#define QUIRKS_DEFAULT (CHIP8Quirks { 0, 1, 0, 0 })
+
+/* A program laid out in memory pages, see rom_cache.hpp */
+struct ROMImage;
+
+/* Snapshot of the CHIP-8 machine state, excluding the keypad */
+struct CHIP8State {
+	uint16_t opcode;
+	uint16_t index;
+	uint16_t program_counter;
+	uint8_t  registers[NUM_REGISTERS];
+	uint8_t  timer_delay;
+	uint8_t  timer_sound;
+	uint16_t stack[STACK_SIZE];
+	uint8_t  stack_pointer;
+	uint8_t  memory[MEMORY_SIZE];
+	uint8_t  display[GRAPHICS_SIZE / 8];
+	uint32_t random_state;
+	uint8_t  fault_flag;
+	CHIP8Quirks quirks;
+	/* Cycle counters of the VIP timing model, 0 when it is not compiled in */
+	uint64_t machine_cycles;
+	uint32_t frame_cycles;
+};
+
+static_assert((MEMORY_SIZE & MEMORY_MASK) == 0, "Memory size must be a power of two to be masked");
+static_assert((STACK_SIZE & (STACK_SIZE - 1)) == 0, "Stack size must be a power of two to be masked");
+static_assert((GRAPHICS_WIDTH & (GRAPHICS_WIDTH - 1)) == 0 && (GRAPHICS_HEIGHT & (GRAPHICS_HEIGHT - 1)) == 0, "Display dimensions must be powers of two to be masked");
+static_assert((KEYPAD_SIZE & (KEYPAD_SIZE - 1)) == 0, "Keypad size must be a power of two to be masked");
+
+/*
+* The machine state held outside of memory. It is trivially copyable and the
+* pristine state is built at compile time, so a reset restores it with one copy.
+*/
+class CHIP8Machine {
+protected:
 	/* Current operator code */
 	uint16_t opcode;
 	/* Index Register: Used with several memory opcodes */
 	uint16_t index;
 	/* Program Counter: Used to keep track of location in code */
 	uint16_t program_counter;
-	/* 1 Byte memory locations */
-	uint8_t  memory[MEMORY_SIZE];
 	/* The processor registers */
-	uint8_t  registers[NUM_REGISTERS];	
+	uint8_t  registers[NUM_REGISTERS];
 	/* Delay registers, count at 60Hz. When set >0, count down to 0 */
 	uint8_t  timer_delay;
 	uint8_t  timer_sound; // Buzzer sounds when timer_sound reaches 0
 	/* The stack for tracking location when in subroutines */
 	uint16_t stack[STACK_SIZE];
 	uint8_t  stack_pointer;
-	/*******************************
-	* Executes the next opcode in memory
-	*******************************/
-	void executeOpcode();
-public:	
+#ifdef CHIP8_VIP_TIMING
+	/* Machine cycles emulated since reset */
+	uint64_t machine_cycles = 0;
+	/* Machine cycles emulated since the start of the current frame */
+	uint32_t frame_cycles = 0;
+#endif
+public:
 	/* Does display need to be redrawn */
 	uint8_t drawFlag;
 	/* Does buzzer need to play */
 	uint8_t beepFlag;
-	/* Black and white pixel display */
-	uint8_t display[GRAPHICS_SIZE];
+	/* Has the program overflowed or underflowed the stack */
+	uint8_t faultFlag;
+	/* Black and white pixel display, GRAPHICS_ROW_BYTES bytes per row */
+	uint8_t display[GRAPHICS_SIZE / 8];
 	/* Buttons on keypad */
 	uint8_t keypad[KEYPAD_SIZE];
 	/*******************************
+	* Creates the machine state of a freshly reset CHIP-8
+	*******************************/
+	constexpr CHIP8Machine()
+		: opcode(0), index(0), program_counter(PROGRAM_START), registers{}, timer_delay(0), timer_sound(0),
+		  stack{}, stack_pointer(0), drawFlag(1), beepFlag(0), faultFlag(0), display{}, keypad{} {}
+};
+
+class CHIP8 : public CHIP8Machine {
+private:
+	/* 1 Byte memory locations, split into copy-on-write pages */
+	PagedMemory memory;
+	/* Interpreter behaviours the emulator follows */
+	CHIP8Quirks quirks = QUIRKS_DEFAULT;
+	/* Memory after a reset and loading the program last loaded, restored by restart */
+	PagedMemory program_memory;
+	/* State of the random number generator used by 0xCXNN */
+	uint32_t random_state;
+	/*******************************
+	* Executes the next opcode in memory
+	*******************************/
+	void executeOpcode();
+	/*******************************
+	* Counts down the delay and sound timers, sounding the buzzer when the sound timer ends
+	*******************************/
+	void updateTimers() {
+		// Update delay timer
+		if (this->timer_delay > 0) {
+			this->timer_delay--;
+		}
+		// Update sound timer
+		if (this->timer_sound > 0) {
+			// Beep at 0
+			if (this->timer_sound == 1) {
+				this->beepFlag = 1;
+			}
+			this->timer_sound--;
+		}
+	}
+#ifdef CHIP8_VIP_TIMING
+	/*******************************
+	* Gets the machine cycles the COSMAC VIP took to run the opcode just executed
+	* @param instruction_address Address the opcode was fetched from
+	* @param vx                  Value of VX before the opcode was executed
+	*******************************/
+	uint32_t opcodeCycles(uint16_t instruction_address, uint8_t vx) const;
+	/*******************************
+	* Advances emulated time, ticking the timers at each frame boundary passed
+	* @param cycles Machine cycles to advance by
+	*******************************/
+	void advanceCycles(uint32_t cycles);
+#endif
+	/*******************************
+	* Reads a byte from memory, wrapping the address into memory
+	* @param address Memory location to read
+	*******************************/
+	uint8_t readMemory(uint16_t address) const {
+		return this->memory.read(CHIP8_MASK(address, MEMORY_MASK));
+	}
+	/*******************************
+	* Writes a byte to memory, wrapping the address into memory.
+	* The page is copied first if it is still shared with a fork.
+	* @param address Memory location to write
+	* @param value   Byte to store at the location
+	*******************************/
+	void writeMemory(uint16_t address, uint8_t value) {
+		this->memory.write(CHIP8_MASK(address, MEMORY_MASK), value);
+	}
+	/*******************************
+	* Gets the next number from the emulators random number generator (xorshift32)
+	*******************************/
+	uint8_t nextRandom() {
+		this->random_state ^= this->random_state << 13;
+		this->random_state ^= this->random_state >> 17;
+		this->random_state ^= this->random_state << 5;
+		return this->random_state >> 24;
+	}
+public:
+	/*******************************
+	* Gets the memory of a freshly reset CHIP-8.
+	* The first page holds the font set at 0x000, every other page is empty.
+	*******************************/
+	static const PagedMemory & pristineMemory();
+	/*******************************
 	* Creates a new CHIP-8 emulator
 	*******************************/
 	CHIP8();
@@ -74,14 +367,117 @@ public:
 	*******************************/
 	void reset();
 	/*******************************
+	* Resets the emulator and reloads the program last loaded.
+	* Memory is refilled in place: the pages the last run wrote are overwritten with
+	* one copy each and kept, so the next run writes them without allocating. Only
+	* the first write to a page no earlier run wrote allocates it.
+	*******************************/
+	void restart();
+	/*******************************
 	* Preforms a cycle on the chip
 	*******************************/
 	void cycle();
 	/*******************************
+	* Runs cycles until the count is reached or the debug policy asks to stop.
+	* The policy is checked before each cycle, with NoDebug the check compiles away.
+	* @param cycles Number of cycles to run
+	* @param debug  Policy with a shouldBreak(const CHIP8 &) check
+	* @return number of cycles run
+	*******************************/
+	template <class DebugPolicy>
+	uint32_t run(uint32_t cycles, DebugPolicy & debug) {
+		uint32_t cycle_iterator;
+
+		for (cycle_iterator = 0; cycle_iterator < cycles; cycle_iterator++) {
+			if (debug.shouldBreak(*this)) {
+				break;
+			}
+			this->cycle();
+		}
+		return cycle_iterator;
+	}
+	/*******************************
+	* Gets the address of the next opcode to execute
+	*******************************/
+	uint16_t getProgramCounter() const {
+		return this->program_counter;
+	}
+	/*******************************
+	* Gets the index register
+	*******************************/
+	uint16_t getIndex() const {
+		return this->index;
+	}
+	/*******************************
+	* Gets a data register
+	* @param number Register to get (0x0-0xF)
+	*******************************/
+	uint8_t getRegister(int number) const {
+		return this->registers[number % NUM_REGISTERS];
+	}
+	/*******************************
+	* Reads a byte of memory without running the emulator
+	* @param address Memory location to read
+	*******************************/
+	uint8_t peekMemory(uint16_t address) const {
+		return this->readMemory(address);
+	}
+#ifdef CHIP8_VIP_TIMING
+	/*******************************
+	* Gets the COSMAC VIP machine cycles emulated since reset
+	*******************************/
+	uint64_t elapsedCycles() const {
+		return this->machine_cycles;
+	}
+#endif
+	/*******************************
+	* Creates a child emulator in the same state as this one.
+	* Registers, stack and display are copied, the memory page table is shared
+	* until either emulator writes to memory.
+	*******************************/
+	CHIP8 fork() const;
+	/*******************************
 	* Loads a file into memory for emulation.
+	* The file is mapped and cached so loading it again only shares the cached pages.
 	* @param file_path Path to the file that is being loaded
+	* @return 1 if the program was loaded, 0 if the file could not be loaded
+	*******************************/
+	uint8_t loadProgram(std::string file_path);
+	/*******************************
+	* Loads a program from a buffer into memory for emulation.
+	* @param program Bytes of the program being loaded
+	* @param length  Number of bytes in the program
+	* @return 1 if the program was loaded, 0 if it is empty or does not fit in memory
+	*******************************/
+	uint8_t loadProgram(const uint8_t * program, int length);
+	/*******************************
+	* Loads a cached program image into memory for emulation and picks its quirks.
+	* @param image Image of the program being loaded
+	*******************************/
+	void loadProgram(std::shared_ptr<const ROMImage> image);
+	/*******************************
+	* Sets the interpreter behaviours the emulator follows.
+	* Loading a program picks the behaviours it was found to rely on, set them after loading to override.
+	* @param quirks Behaviours to follow
 	*******************************/
-	void loadProgram(std::string file_path);
+	void setQuirks(CHIP8Quirks quirks);
+	/*******************************
+	* Copies the machine state into a snapshot
+	* @param state Snapshot to store the state in
+	*******************************/
+	void saveState(CHIP8State * state) const;
+	/*******************************
+	* Restores the machine state from a snapshot
+	* @param state Snapshot to restore the state from
+	*******************************/
+	void loadState(const CHIP8State * state);
+};
+
+/* Debug policy for CHIP8::run that never stops the emulator */
+struct NoDebug {
+	bool shouldBreak(const CHIP8 &) const {
+		return false;
+	}
 };
 
 #endif
@@ -1,17 +1,37 @@
 #include <iostream>
+#include <cstdlib>
+#include <string>
 
 #include "emulator.hpp"
 
 int main(int argc, char* argv[]) {
-	// Check to ensure a program to run has been passed in
-	if (argc != 2) {
-		std::cout << "Proper Usage:\n    chip8 <path_to_program>" << std::endl;
+	std::string option;
+	int argument_iterator;
+
+	// Check to ensure a program to run and a value for each option have been passed in
+	if (argc < 2 || argc % 2 != 0) {
+		std::cout << "Proper Usage:\n    chip8 <path_to_program> [--turbo-cycles <cycles>] [--stats <stats_file>]" << std::endl;
 		return 0;
 	}
 	// Create a new emulator
 	CHIP8Emulator ce = CHIP8Emulator();
+	// Each option is followed by its value and they may be given in any order
+	for (argument_iterator = 2; argument_iterator < argc; argument_iterator += 2) {
+		option = argv[argument_iterator];
+		if (option == "--turbo-cycles") {
+			// Set the cycles run between input checks while fast forwarding
+			ce.setTurboLoopCycles(atoi(argv[argument_iterator + 1]));
+		} else if (option == "--stats") {
+			// Write the performance counters to a file
+			if (! ce.setStatsFile(argv[argument_iterator + 1])) {
+				return 1;
+			}
+		} else {
+			std::cout << "Unknown option " << option << std::endl;
+			return 1;
+		}
+	}
 	// Load the specified program into the emulator
 	ce.startProgram(argv[1]);
 	return 0;
 }
-
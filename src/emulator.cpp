@@ -3,34 +3,115 @@
 
 // Loads a game and starts running it
 void CHIP8Emulator::startProgram(std::string file_path) {
+	uint8_t overlay_key;
+	uint8_t turbo_key;
+
 	// Reset the hardware
 	this->hardware.reset();
 	// Load the program into the CHIP8 memory
-	this->hardware.loadProgram(file_path);
+	if (! this->hardware.loadProgram(file_path)) {
+		return;
+	}
 
 	while (1) {
-		// sleep between 
-		this->display.sleep(CLOCK_DELAY);
-		// Check if the display needs to be updated
-		if (this->hardware.drawFlag) {
-			this->drawScreen();
-			this->hardware.drawFlag = 0;
-		}
-		// Check if the buzzer needs to be sounded
+		// sleep between clocks unless fast forwarding
+		if (! this->turbo) {
+			this->display.sleep(CLOCK_DELAY);
+		}
+		// Update the counters, redrawing the overlay when they change
+		if (this->stats.update(this->display.microseconds()) && this->overlay) {
+			this->frame_pending = 1;
+		}
+		// Check if the display needs to be updated, only presenting at the frame rate when fast forwarding
+		if (this->frame_pending && (! this->turbo || this->display.ticks() - this->last_present >= TURBO_FRAME_DELAY)) {
+			this->presentFrame();
+			this->frame_pending = 0;
+			this->last_present = this->display.ticks();
+		}
+		// Check if the buzzer needs to be sounded, the buzzer is muted when fast forwarding
 		if (this->hardware.beepFlag) {
-			this->playBeep();
+			if (! this->turbo) {
+				this->playBeep();
+			}
 			this->hardware.beepFlag = 0;
 		}
 		// Check for any inputs
 		this->setKeys();
-		// Send a clock to the processor
-		this->hardware.cycle();
+		turbo_key = this->display.keyPressed(TURBO_KEY);
+		// Stop waiting for vsync while fast forwarding so presents do not throttle the hardware
+		if (turbo_key != this->turbo) {
+			this->turbo = turbo_key;
+			this->display.setVSync(! this->turbo);
+		}
+		// Toggle the overlay when its key is first pressed
+		overlay_key = this->display.keyPressed(OVERLAY_KEY);
+		if (overlay_key && ! this->overlay_key_held) {
+			this->overlay = ! this->overlay;
+			this->frame_pending = 1;
+		}
+		this->overlay_key_held = overlay_key;
+		// Send clocks to the processor
+		this->stats.addInstructions(this->runCycles());
+	}
+}
+
+// Sets the number of cycles run per loop, between input checks, while fast forwarding.
+void CHIP8Emulator::setTurboLoopCycles(int cycles) {
+	this->turbo_loop_cycles = cycles < 0 ? 0 : cycles;
+}
+
+// Appends the performance counters to a file once per second
+uint8_t CHIP8Emulator::setStatsFile(std::string file_path) {
+	return this->stats.openFile(file_path);
+}
+
+// Run the hardware for one loop of the emulator.
+uint32_t CHIP8Emulator::runCycles() {
+	int cycle_iterator;
+	uint32_t frame_end;
+	uint32_t cycles;
+
+	// Single clock when running at normal speed
+	if (! this->turbo) {
+		this->stepHardware();
+		return 1;
+	}
+	// Fixed number of clocks per loop when fast forwarding with a set loop size
+	if (this->turbo_loop_cycles > 0) {
+		for (cycle_iterator = 0; cycle_iterator < this->turbo_loop_cycles; cycle_iterator++) {
+			this->stepHardware();
+		}
+		return this->turbo_loop_cycles;
 	}
+	// Run uncapped for a frame, checking the clock once per batch
+	frame_end = this->display.ticks() + TURBO_FRAME_DELAY;
+	cycles = 0;
+	do {
+		for (cycle_iterator = 0; cycle_iterator < TURBO_BATCH; cycle_iterator++) {
+			this->stepHardware();
+		}
+		cycles += TURBO_BATCH;
+	} while ((int32_t) (frame_end - this->display.ticks()) > 0);
+	return cycles;
+}
+
+// Draw the screen and record how long it took
+void CHIP8Emulator::presentFrame() {
+	uint64_t start;
+	uint64_t end;
+
+	start = this->display.microseconds();
+	this->drawScreen();
+	end = this->display.microseconds();
+	// Drawing time excludes the wait for vsync, which is counted on its own
+	this->stats.framePresented(end, end - start - this->display.presentTime(), this->display.presentTime());
 }
 
 // Check the keymap and set the results array to 1 at each pressed key in the map.
 void CHIP8Emulator::setKeys() {
-	this->display.setKeys(KEYPAD_SIZE, this->keymap, this->hardware.keypad);
+	if (this->display.setKeys(KEYPAD_SIZE, this->keymap, this->hardware.keypad)) {
+		this->stats.inputReceived(this->display.microseconds());
+	}
 }
 
 // Play the beep from the speakers
@@ -48,13 +129,17 @@ void CHIP8Emulator::drawScreen() {
 	for (row_iterator = 0; row_iterator < GRAPHICS_HEIGHT; row_iterator++) {
 		for (cell_iterator = 0; cell_iterator < GRAPHICS_WIDTH; cell_iterator++) {
 			// Check if this cell is activated in the chips video memory
-			if (this->hardware.display[(row_iterator * GRAPHICS_WIDTH) + cell_iterator]) {
+			if (this->hardware.display[(row_iterator * GRAPHICS_ROW_BYTES) + cell_iterator / 8] & (0x80 >> (cell_iterator % 8))) {
 				this->display.setPixel(row_iterator, cell_iterator, 255, 255, 255);
 			} else {
 				this->display.setPixel(row_iterator, cell_iterator, 0, 0, 0);
 			}
 		}
 	}
+	// Draw the performance overlay over the game
+	if (this->overlay) {
+		this->display.drawOverlay(this->stats);
+	}
 
 	this->display.refresh();
 }
\ No newline at end of file
@@ -6,9 +6,20 @@
 
 #include "sdl.hpp"
 #include "chip8.hpp"
+#include "perf_stats.hpp"
 
 //ms between clock (1000ms / 60hz ~= 12ms between refreshes)
 #define CLOCK_DELAY 0
+//ms between presented frames while fast forwarding (1000ms / 60hz ~= 16ms)
+#define TURBO_FRAME_DELAY 16
+//Cycles run per loop between input checks while fast forwarding (0 runs until the next frame is due)
+#define TURBO_LOOP_CYCLES 0
+//Cycles run between clock checks when fast forwarding uncapped
+#define TURBO_BATCH 256
+//Key held down to fast forward
+#define TURBO_KEY SDL_SCANCODE_TAB
+//Key pressed to show or hide the performance overlay
+#define OVERLAY_KEY SDL_SCANCODE_F1
 
 class CHIP8Emulator {
 public:
@@ -21,6 +32,21 @@ public:
 	**********************/
 	void startProgram(std::string file_path);
 
+	/**********************
+	* Sets the number of cycles run per loop, between input checks, while fast forwarding.
+	* Fast forwarding is uncapped either way, this only sets how often input is read.
+	* 0 runs the hardware until the next frame is due.
+	* @param cycles Cycles to run per loop while fast forwarding
+	**********************/
+	void setTurboLoopCycles(int cycles);
+
+	/**********************
+	* Appends the performance counters to a file once per second
+	* @param file_path Path to the stats file
+	* @return 1 if the file was opened, 0 otherwise
+	**********************/
+	uint8_t setStatsFile(std::string file_path);
+
 private:
 	/* The display and input module */
 	SDLDisplay display = SDLDisplay(GRAPHICS_WIDTH, GRAPHICS_HEIGHT, 8);
@@ -36,6 +62,46 @@ private:
 		SDL_SCANCODE_Z, SDL_SCANCODE_X, SDL_SCANCODE_C, SDL_SCANCODE_V
 	};
 
+	/* Is the emulator fast forwarding */
+	uint8_t turbo = 0;
+	/* Cycles per loop between input checks while fast forwarding */
+	int turbo_loop_cycles = TURBO_LOOP_CYCLES;
+	/* Tick count when the last frame was presented */
+	uint32_t last_present = 0;
+
+	/* Does the program have a frame waiting to be presented */
+	uint8_t frame_pending = 1;
+	/* Performance counters for the overlay and stats file */
+	PerfStats stats;
+	/* Is the performance overlay shown */
+	uint8_t overlay = 0;
+	/* Was the overlay key held on the last loop */
+	uint8_t overlay_key_held = 0;
+
+	/*******************
+	* Run a single cycle on the hardware, noting any display update it made
+	*******************/
+	void stepHardware() {
+		this->hardware.cycle();
+		if (this->hardware.drawFlag) {
+			this->hardware.drawFlag = 0;
+			this->frame_pending = 1;
+			this->stats.emulatedFrame();
+		}
+	}
+
+	/*******************
+	* Run the hardware for one loop of the emulator.
+	* Runs a single cycle normally or a batch of cycles when fast forwarding.
+	* @return number of cycles run
+	*******************/
+	uint32_t runCycles();
+
+	/*******************
+	* Draw the screen and record how long it took
+	*******************/
+	void presentFrame();
+
 	/*******************
 	* Check the keymap and set the results array to 1 at each pressed key in the map.
 	*******************/
@@ -0,0 +1,201 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "libchip8.h"
+
+// Number of random programs run when none is given
+#define FUZZ_PROGRAMS 2000
+// Number of cycles each program is run for when none is given
+#define FUZZ_CYCLES 10000
+// Cycles run between keypad changes
+#define FUZZ_KEY_CYCLES 100
+// Bytes in each random program, as large as fits in memory
+#define FUZZ_PROGRAM_SIZE (4096 - 0x200)
+// Cycles the reference program is timed for
+#define FUZZ_REFERENCE_CYCLES 10000000
+// Times the reference program is run on each library, the fastest run is reported
+#define FUZZ_REFERENCE_RUNS 5
+// Library built with the index masks compiled out when none is given, see make libchip8-unmasked
+#define FUZZ_UNMASKED_LIBRARY "bin/libchip8-unmasked.so"
+
+/* Entry points of a build of the library the reference program is timed on */
+struct chip8_api {
+	chip8_t * (* create)(void);
+	void (* destroy)(chip8_t *);
+	int (* load_rom)(chip8_t *, const uint8_t *, size_t);
+	int (* step)(chip8_t *, uint32_t);
+};
+
+/*******************
+* Gets the current time in nanoseconds
+*******************/
+static double now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*******************
+* Gets the next number from a xorshift32 generator
+* @param state State of the generator, must not be 0
+*******************/
+static uint32_t next_random(uint32_t * state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/*******************
+* Times a fixed program of loads, arithmetic, BCD, register transfers and draws.
+* Every address it touches stays in memory, so it also runs on a build without masks.
+* @param api Library to run the program on
+* @return nanoseconds per cycle, or a negative number if it could not be run
+*******************/
+static double time_reference(const struct chip8_api * api) {
+	// loop: I=0x220, V0+=1, FX33, F265, V0+=V1, D015, jump to loop
+	static const uint8_t reference[] = {
+		0xA2, 0x20, 0x70, 0x01, 0xF0, 0x33, 0xF2, 0x65,
+		0x80, 0x14, 0xD0, 0x15, 0x12, 0x00
+	};
+	chip8_t * emulator;
+	double start;
+	double elapsed;
+
+	emulator = api->create();
+	if (emulator == NULL || api->load_rom(emulator, reference, sizeof(reference)) != 0) {
+		api->destroy(emulator);
+		return -1;
+	}
+	start = now_ns();
+	api->step(emulator, FUZZ_REFERENCE_CYCLES);
+	elapsed = now_ns() - start;
+	api->destroy(emulator);
+	return elapsed / FUZZ_REFERENCE_CYCLES;
+}
+
+/*******************
+* Loads the entry points of another build of the library
+* @param path Shared library to load
+* @param api  Entry points to fill in
+* @return 1 if every entry point was found, 0 otherwise
+*******************/
+static int load_api(const char * path, struct chip8_api * api) {
+	void * library;
+
+	// Keep its symbols to itself so they do not stand in for the linked library
+	library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (library == NULL) {
+		return 0;
+	}
+	api->create = (chip8_t * (*)(void)) dlsym(library, "chip8_create");
+	api->destroy = (void (*)(chip8_t *)) dlsym(library, "chip8_destroy");
+	api->load_rom = (int (*)(chip8_t *, const uint8_t *, size_t)) dlsym(library, "chip8_load_rom");
+	api->step = (int (*)(chip8_t *, uint32_t)) dlsym(library, "chip8_step");
+	return api->create != NULL && api->destroy != NULL && api->load_rom != NULL && api->step != NULL;
+}
+
+int main(int argc, char * argv[]) {
+	static const struct chip8_api masked = { chip8_create, chip8_destroy, chip8_load_rom, chip8_step };
+	struct chip8_api unmasked;
+	const char * unmasked_path;
+	uint8_t rom[FUZZ_PROGRAM_SIZE];
+	uint32_t random_state;
+	chip8_t * emulator;
+	chip8_state_t state;
+	long programs;
+	long cycles;
+	long program_iterator;
+	long cycle_iterator;
+	int byte_iterator;
+	double cycles_run;
+	long faults;
+	long failures;
+	double start;
+	double elapsed;
+	double reference;
+	double baseline;
+	double run;
+	int run_iterator;
+
+	// Every argument is optional
+	if (argc > 4) {
+		printf("Proper Usage:\n    chip8-fuzz [programs] [cycles_per_program] [unmasked_library]\n");
+		return 0;
+	}
+	programs = argc > 1 ? atol(argv[1]) : FUZZ_PROGRAMS;
+	cycles = argc > 2 ? atol(argv[2]) : FUZZ_CYCLES;
+	unmasked_path = argc > 3 ? argv[3] : FUZZ_UNMASKED_LIBRARY;
+
+	emulator = chip8_create();
+	if (emulator == NULL) {
+		printf("Could not create an emulator\n");
+		return 1;
+	}
+	random_state = 0x2545F491;
+	faults = 0;
+	failures = 0;
+	elapsed = 0;
+	cycles_run = 0;
+	for (program_iterator = 0; program_iterator < programs; program_iterator++) {
+		for (byte_iterator = 0; byte_iterator < FUZZ_PROGRAM_SIZE; byte_iterator++) {
+			rom[byte_iterator] = (uint8_t) next_random(&random_state);
+		}
+		chip8_reset(emulator);
+		if (chip8_load_rom(emulator, rom, sizeof(rom)) != 0) {
+			failures++;
+			continue;
+		}
+		// Press random keys every so often so key waits and skips take both paths
+		start = now_ns();
+		for (cycle_iterator = 0; cycle_iterator < cycles; cycle_iterator += FUZZ_KEY_CYCLES) {
+			chip8_set_keys(emulator, (uint16_t) next_random(&random_state));
+			if (chip8_step(emulator, FUZZ_KEY_CYCLES) != 0) {
+				failures++;
+				break;
+			}
+			cycles_run += FUZZ_KEY_CYCLES;
+		}
+		elapsed += now_ns() - start;
+		// Every address the program can reach is masked into the machine
+		chip8_get_state(emulator, &state);
+		if (state.stack_pointer >= 2 * 16) {
+			printf("Program %ld left the stack pointer at %d\n", program_iterator, state.stack_pointer);
+			failures++;
+		}
+		faults += chip8_faulted(emulator);
+	}
+	chip8_destroy(emulator);
+
+	printf("Random programs:   %ld x %ld cycles, %ld stack faults, %ld failures\n", programs, cycles, faults, failures);
+	if (cycles_run > 0) {
+		printf("Random cycles:     %8.2f ns/cycle\n", elapsed / cycles_run);
+	}
+	// Time the reference program on this library and on a build without the masks, taking turns
+	// so both see the same machine load
+	if (! load_api(unmasked_path, &unmasked)) {
+		unmasked.create = NULL;
+	}
+	reference = -1;
+	baseline = -1;
+	for (run_iterator = 0; run_iterator < FUZZ_REFERENCE_RUNS; run_iterator++) {
+		run = time_reference(&masked);
+		reference = reference < 0 || (run >= 0 && run < reference) ? run : reference;
+		if (unmasked.create != NULL) {
+			run = time_reference(&unmasked);
+			baseline = baseline < 0 || (run >= 0 && run < baseline) ? run : baseline;
+		}
+	}
+	printf("Reference cycles:  %8.2f ns/cycle\n", reference);
+	if (baseline > 0) {
+		printf("Without masks:     %8.2f ns/cycle, the masks cost %+.1f%%\n", baseline, (reference / baseline - 1) * 100);
+	} else {
+		printf("Without masks:     %s not loaded, build it with make libchip8-unmasked\n", unmasked_path);
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+# Scripted GDB remote protocol client for chip8-gdbserver.
+# Starts the server on a small program, drives breakpoints, single step,
+# write watchpoints, memory access, interrupts and malformed packets, and
+# checks every reply. Exits with 1 on the first unexpected reply.
+#
+# Usage: gdb_client.py <path_to_chip8-gdbserver>
+
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+# I=0x300, V0=123, loop: store the BCD of V0 at I, V0+=1
+PROGRAM = bytes([
+	0xA3, 0x00,  # 0x200 ANNN
+	0x60, 0x7B,  # 0x202 6XNN
+	0xF0, 0x33,  # 0x204 FX33
+	0x70, 0x01,  # 0x206 7XNN
+	0x12, 0x04,  # 0x208 1NNN
+])
+
+# Seconds to wait for the server to start listening or exit
+TIMEOUT = 5
+
+
+class Session:
+	"""A debugger connection to a freshly started server"""
+
+	def __init__(self, server, program, socket_path):
+		self.process = subprocess.Popen([server, socket_path, program], stdout=subprocess.DEVNULL)
+		deadline = time.time() + TIMEOUT
+		while not os.path.exists(socket_path):
+			if time.time() > deadline or self.process.poll() is not None:
+				fail("server did not start listening on " + socket_path)
+			time.sleep(0.01)
+		self.connection = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+		self.connection.settimeout(TIMEOUT)
+		self.connection.connect(socket_path)
+		self.buffer = b""
+
+	def send(self, packet):
+		"""Sends a packet without waiting for the reply"""
+		checksum = sum(packet.encode()) % 256
+		self.connection.sendall(("$%s#%02x" % (packet, checksum)).encode())
+
+	def reply(self):
+		"""Reads the next reply packet, skipping acknowledgements"""
+		while True:
+			start = self.buffer.find(b"$")
+			end = self.buffer.find(b"#", start + 1)
+			if start >= 0 and end >= 0 and len(self.buffer) >= end + 3:
+				packet = self.buffer[start + 1:end].decode()
+				self.buffer = self.buffer[end + 3:]
+				return packet
+			data = self.connection.recv(4096)
+			if not data:
+				fail("server closed the connection")
+			self.buffer += data
+
+	def expect(self, packet, expected):
+		"""Sends a packet and checks its reply"""
+		self.send(packet)
+		got = self.reply()
+		if got != expected:
+			fail("%s replied %r, expected %r" % (packet, got, expected))
+		print("%-20s -> %s" % (packet, got))
+
+	def wait(self):
+		"""Waits for the server to exit and gets its return code"""
+		try:
+			return self.process.wait(timeout=TIMEOUT)
+		except subprocess.TimeoutExpired:
+			self.process.kill()
+			fail("server did not exit")
+
+
+def fail(message):
+	print("FAIL: " + message)
+	sys.exit(1)
+
+
+def main():
+	if len(sys.argv) != 2:
+		print("Proper Usage:\n    gdb_client.py <path_to_chip8-gdbserver>")
+		return 0
+	server = sys.argv[1]
+	with tempfile.TemporaryDirectory() as directory:
+		program = os.path.join(directory, "watch.ch8")
+		with open(program, "wb") as program_file:
+			program_file.write(PROGRAM)
+
+		session = Session(server, program, os.path.join(directory, "session.sock"))
+		session.expect("?", "S05")
+		# Break before the BCD store, then step over it
+		session.expect("Z0,204,2", "OK")
+		session.expect("c", "S05")
+		session.expect("p11", "0204")
+		session.expect("s", "S05")
+		session.expect("p11", "0206")
+		session.expect("p10", "0300")
+		session.expect("m300,3", "010203")
+		# Stop once the next BCD store has written to a watched address
+		session.expect("z0,204,2", "OK")
+		session.expect("Z2,301,1", "OK")
+		session.expect("c", "T05watch:0301;")
+		session.expect("p11", "0206")
+		session.expect("p0", "7c")
+		session.expect("m300,3", "010204")
+		# Stepping over code that writes nothing watched is a plain stop
+		session.expect("s", "S05")
+		session.expect("p11", "0208")
+		# Stepping over the watched write reports it
+		session.expect("s", "S05")
+		session.expect("p11", "0204")
+		session.expect("s", "T05watch:0301;")
+		session.expect("p11", "0206")
+		session.expect("m300,3", "010205")
+		session.expect("z2,301,1", "OK")
+		# Write memory and read it back
+		session.expect("M300,2:abcd", "OK")
+		session.expect("m300,2", "abcd")
+		# Lengths that do not match the packet are rejected and the server keeps serving
+		session.expect("M300,80000001:00", "E01")
+		session.expect("M300,2:ab", "E01")
+		session.expect("M300,2", "E01")
+		session.expect("mffffffff,ffffffff", "E01")
+		session.expect("Z2,300,ffffffff", "E01")
+		session.expect("G00", "E01")
+		# A full register write is applied
+		registers = "00" * 16 + "0300" + "0206" + "00" + "00" + "00"
+		session.expect("G" + registers, "OK")
+		session.expect("g", registers)
+		# The last stop is still the watched write
+		session.expect("?", "T05watch:0301;")
+		# Interrupt a continue
+		session.send("c")
+		time.sleep(0.1)
+		session.connection.sendall(b"\x03")
+		got = session.reply()
+		if got != "S02":
+			fail("interrupt replied %r, expected 'S02'" % got)
+		print("%-20s -> %s" % ("^C", got))
+		session.expect("D", "OK")
+		if session.wait() != 0:
+			fail("server exited with %d after detaching" % session.process.returncode)
+
+		# A debugger vanishing mid continue must not kill the server with SIGPIPE
+		session = Session(server, program, os.path.join(directory, "disconnect.sock"))
+		session.send("c")
+		session.connection.close()
+		code = session.wait()
+		if code != 0:
+			fail("server exited with %d after the debugger disconnected" % code)
+		print("%-20s -> exit %d" % ("disconnect", code))
+	print("All replies matched")
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())
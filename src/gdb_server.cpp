@@ -0,0 +1,36 @@
+#include <iostream>
+#include <cstdlib>
+#include <csignal>
+
+#include "gdb_stub.hpp"
+
+int main(int argc, char* argv[]) {
+	CHIP8 hardware;
+	GDBStub stub(hardware);
+	std::string address;
+	uint8_t listening;
+
+	// Check to ensure a socket and program have been passed in
+	if (argc != 3) {
+		std::cout << "Proper Usage:\n    chip8-gdbserver <port|socket_path> <path_to_program>" << std::endl;
+		return 0;
+	}
+	if (! hardware.loadProgram(std::string(argv[2]))) {
+		return 1;
+	}
+	// A number is a TCP port on 127.0.0.1, anything else is a unix socket path
+	address = argv[1];
+	if (address.find_first_not_of("0123456789") == std::string::npos) {
+		listening = stub.listenTCP(atoi(argv[1]));
+	} else {
+		listening = stub.listenUnix(address);
+	}
+	if (! listening) {
+		return 1;
+	}
+	// A debugger disconnecting mid reply must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+	std::cout << "Waiting for debugger on " << address << std::endl;
+	stub.serve();
+	return 0;
+}
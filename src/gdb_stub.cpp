@@ -0,0 +1,428 @@
+#include "gdb_stub.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// A debugger disconnecting must not kill the emulator with SIGPIPE.
+// Where sends cannot opt out of the signal the server ignores it instead.
+#ifdef MSG_NOSIGNAL
+#define GDB_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define GDB_SEND_FLAGS 0
+#endif
+
+/********************
+* Converts a value to a fixed number of hex digits
+********************/
+static std::string toHex(unsigned int value, int digits) {
+	char buffer[9];
+
+	snprintf(buffer, sizeof(buffer), "%0*x", digits, value);
+	return std::string(buffer);
+}
+
+/********************
+* Reads a hex number from a packet, advancing the position past it
+********************/
+static unsigned int fromHex(const std::string & text, size_t & position) {
+	unsigned int value;
+	char digit;
+
+	value = 0;
+	while (position < text.size() && isxdigit(text[position])) {
+		digit = text[position++];
+		value = value * 16 + (isdigit(digit) ? digit - '0' : (tolower(digit) - 'a' + 10));
+	}
+	return value;
+}
+
+/********************
+* Reads a fixed number of hex digits from a packet, invalid or missing digits read as 0
+********************/
+static unsigned int fromHex(const std::string & text, size_t start, int digits) {
+	size_t position;
+	std::string field;
+
+	if (start >= text.size()) {
+		return 0;
+	}
+	field = text.substr(start, digits);
+	position = 0;
+	return fromHex(field, position);
+}
+
+// Creates a debug stub for an emulator
+GDBStub::GDBStub(CHIP8 & hardware) : hardware(hardware) {}
+
+// Closes any open sockets
+GDBStub::~GDBStub() {
+	if (this->client_socket >= 0) {
+		close(this->client_socket);
+	}
+	if (this->listen_socket >= 0) {
+		close(this->listen_socket);
+	}
+	if (! this->unix_path.empty()) {
+		unlink(this->unix_path.c_str());
+	}
+}
+
+// Listens for a debugger on a local TCP port
+uint8_t GDBStub::listenTCP(int port) {
+	struct sockaddr_in address = {};
+	int reuse = 1;
+
+	this->listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+	if (this->listen_socket < 0) {
+		perror("GDB stub socket");
+		return 0;
+	}
+	setsockopt(this->listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	// Only accept debuggers on this machine
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(this->listen_socket, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(this->listen_socket, 1) != 0) {
+		perror("GDB stub listen");
+		return 0;
+	}
+	return 1;
+}
+
+// Listens for a debugger on a unix socket
+uint8_t GDBStub::listenUnix(std::string path) {
+	struct sockaddr_un address = {};
+
+	if (path.size() >= sizeof(address.sun_path)) {
+		std::cout << "GDB stub socket path " << path << " is too long" << std::endl;
+		return 0;
+	}
+	this->listen_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (this->listen_socket < 0) {
+		perror("GDB stub socket");
+		return 0;
+	}
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	unlink(path.c_str());
+	if (bind(this->listen_socket, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(this->listen_socket, 1) != 0) {
+		perror("GDB stub listen");
+		return 0;
+	}
+	this->unix_path = path;
+	return 1;
+}
+
+// Waits for a debugger to connect and serves it until it detaches or disconnects
+void GDBStub::serve() {
+	std::string packet;
+	std::string reply;
+	bool done;
+
+	this->client_socket = accept(this->listen_socket, NULL, NULL);
+	if (this->client_socket < 0) {
+		perror("GDB stub accept");
+		return;
+	}
+	done = false;
+	while (! done && this->readPacket(packet)) {
+		reply = this->handlePacket(packet, done);
+		// Kill has no reply
+		if (packet != "k") {
+			this->sendPacket(reply);
+		}
+	}
+	close(this->client_socket);
+	this->client_socket = -1;
+}
+
+// Debug policy check made by CHIP8::run before each cycle.
+bool GDBStub::shouldBreak(const CHIP8 & hardware) {
+	uint16_t program_counter;
+	uint16_t opcode;
+	int write_length;
+	int byte_iterator;
+
+	// The opcode run last wrote to a watched address, stop now the write is done
+	if (this->watch_hit) {
+		this->watch_hit = 0;
+		return true;
+	}
+	program_counter = hardware.getProgramCounter();
+	// Resuming runs the opcode the emulator stopped at even if it has a breakpoint
+	if (program_counter != this->resume_address && GDBStub::testBit(this->breakpoints, program_counter)) {
+		this->stop_reply = "S05";
+		return true;
+	}
+	this->resume_address = -1;
+	// Only 0xFX33 and 0xFX55 write to memory, let them write to a watched address and stop after
+	opcode = hardware.peekMemory(program_counter) << 8 | hardware.peekMemory(program_counter + 1);
+	if ((opcode & 0xF0FF) == 0xF033) {
+		write_length = 3;
+	} else if ((opcode & 0xF0FF) == 0xF055) {
+		write_length = ((opcode & 0x0F00) >> 8) + 1;
+	} else {
+		return false;
+	}
+	for (byte_iterator = 0; byte_iterator < write_length; byte_iterator++) {
+		if (GDBStub::testBit(this->watchpoints, hardware.getIndex() + byte_iterator)) {
+			this->stop_reply = "T05watch:" + toHex((hardware.getIndex() + byte_iterator) & MEMORY_MASK, 4) + ";";
+			this->watch_hit = 1;
+			return false;
+		}
+	}
+	return false;
+}
+
+// Sets or clears a range of addresses in a bitmap
+void GDBStub::setBits(uint64_t * bitmap, uint16_t address, int length, bool value) {
+	int byte_iterator;
+	uint16_t location;
+
+	for (byte_iterator = 0; byte_iterator < length; byte_iterator++) {
+		location = (address + byte_iterator) & MEMORY_MASK;
+		if (value) {
+			bitmap[location / 64] |= (uint64_t) 1 << (location % 64);
+		} else {
+			bitmap[location / 64] &= ~((uint64_t) 1 << (location % 64));
+		}
+	}
+}
+
+// Reads the next packet from the debugger, acknowledging it
+uint8_t GDBStub::readPacket(std::string & packet) {
+	char character;
+	char checksum[2];
+
+	packet.clear();
+	// Skip acknowledgements and interrupts until the start of a packet
+	do {
+		if (recv(this->client_socket, &character, 1, 0) != 1) {
+			return 0;
+		}
+	} while (character != '$');
+	while (1) {
+		if (recv(this->client_socket, &character, 1, 0) != 1) {
+			return 0;
+		}
+		if (character == '#') {
+			break;
+		}
+		if (packet.size() < GDB_PACKET_SIZE) {
+			packet += character;
+		}
+	}
+	if (recv(this->client_socket, checksum, 2, MSG_WAITALL) != 2) {
+		return 0;
+	}
+	send(this->client_socket, "+", 1, GDB_SEND_FLAGS);
+	return 1;
+}
+
+// Sends a packet to the debugger
+void GDBStub::sendPacket(const std::string & packet) {
+	std::string framed;
+	uint8_t checksum;
+
+	checksum = 0;
+	for (char character : packet) {
+		checksum += character;
+	}
+	framed = "$" + packet + "#" + toHex(checksum, 2);
+	send(this->client_socket, framed.c_str(), framed.size(), GDB_SEND_FLAGS);
+}
+
+// Checks if the debugger has sent an interrupt (0x03) without blocking
+uint8_t GDBStub::interrupted() {
+	struct pollfd poll_socket = { this->client_socket, POLLIN, 0 };
+	char character;
+
+	while (poll(&poll_socket, 1, 0) > 0 && (poll_socket.revents & POLLIN)) {
+		if (recv(this->client_socket, &character, 1, 0) != 1) {
+			return 1;
+		}
+		if (character == 0x03) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Runs the emulator until it stops, returning the stop reply
+std::string GDBStub::resume(bool single) {
+	// Step past whatever the emulator stopped at
+	this->resume_address = this->hardware.getProgramCounter();
+	if (single) {
+		this->stop_reply = "S05";
+		this->hardware.run(1, *this);
+		this->watch_hit = 0;
+		return this->stop_reply;
+	}
+	// A watched write made by the last opcode of a batch has no check after it to stop at
+	while (this->hardware.run(GDB_CONTINUE_BATCH, *this) == GDB_CONTINUE_BATCH && ! this->watch_hit) {
+		if (this->interrupted()) {
+			this->stop_reply = "S02";
+			break;
+		}
+	}
+	this->watch_hit = 0;
+	return this->stop_reply;
+}
+
+// Handles a packet and returns the reply
+std::string GDBStub::handlePacket(const std::string & packet, bool & done) {
+	CHIP8State state;
+	std::string reply;
+	size_t position;
+	unsigned int address;
+	unsigned int length;
+	unsigned int kind;
+	unsigned int byte_iterator;
+
+	if (packet.empty()) {
+		return "";
+	}
+	position = 1;
+	switch (packet[0]) {
+		// Why the emulator stopped
+		case '?':
+			return this->stop_reply;
+		// Read and write all registers
+		case 'g':
+			return this->readRegisters();
+		case 'G':
+			return this->writeRegisters(packet.substr(1)) ? "OK" : "E01";
+		// Read a single register
+		case 'p':
+			address = fromHex(packet, position);
+			if (address >= GDB_NUM_REGISTERS) {
+				return "E01";
+			}
+			reply = this->readRegisters();
+			// I and PC take 4 digits, every other register takes 2
+			if (address < NUM_REGISTERS) {
+				return reply.substr(address * 2, 2);
+			}
+			if (address < NUM_REGISTERS + 2) {
+				return reply.substr(NUM_REGISTERS * 2 + (address - NUM_REGISTERS) * 4, 4);
+			}
+			return reply.substr(NUM_REGISTERS * 2 + 8 + (address - NUM_REGISTERS - 2) * 2, 2);
+		// Read memory
+		case 'm':
+			address = fromHex(packet, position);
+			position++;
+			length = fromHex(packet, position);
+			// The reply takes 2 digits per byte and must fit in a packet
+			if (length > GDB_PACKET_SIZE / 2) {
+				return "E01";
+			}
+			for (byte_iterator = 0; byte_iterator < length; byte_iterator++) {
+				reply += toHex(this->hardware.peekMemory(address + byte_iterator), 2);
+			}
+			return reply;
+		// Write memory
+		case 'M':
+			address = fromHex(packet, position);
+			position++;
+			length = fromHex(packet, position);
+			position++;
+			// Check the length against the digits sent, without multiplying it so it cannot overflow
+			if (position > packet.size() || length > (packet.size() - position) / 2) {
+				return "E01";
+			}
+			this->hardware.saveState(&state);
+			for (byte_iterator = 0; byte_iterator < length; byte_iterator++) {
+				state.memory[(address + byte_iterator) & MEMORY_MASK] = fromHex(packet, position + byte_iterator * 2, 2);
+			}
+			this->hardware.loadState(&state);
+			return "OK";
+		// Step and continue, resuming at another address is not supported
+		case 's':
+			return this->resume(true);
+		case 'c':
+			return this->resume(false);
+		// Insert and remove breakpoints and write watchpoints
+		case 'Z':
+		case 'z':
+			kind = fromHex(packet, position);
+			position++;
+			address = fromHex(packet, position);
+			position++;
+			length = fromHex(packet, position);
+			if (kind == 0 || kind == 1) {
+				GDBStub::setBits(this->breakpoints, address, 1, packet[0] == 'Z');
+				return "OK";
+			}
+			if (kind == 2) {
+				// Larger watchpoints would only cover memory again
+				if (length > MEMORY_SIZE) {
+					return "E01";
+				}
+				GDBStub::setBits(this->watchpoints, address, length, packet[0] == 'Z');
+				return "OK";
+			}
+			return "";
+		// Detach or kill ends the session
+		case 'D':
+		case 'k':
+			done = true;
+			return "OK";
+		case 'H':
+			return "OK";
+		case 'q':
+			if (packet.compare(0, 10, "qSupported") == 0) {
+				return "PacketSize=" + toHex(GDB_PACKET_SIZE, 1);
+			}
+			if (packet == "qAttached") {
+				return "1";
+			}
+			return "";
+		default:
+			return "";
+	}
+}
+
+// Gets the registers as a hex string in debugger order
+std::string GDBStub::readRegisters() {
+	CHIP8State state;
+	std::string reply;
+	int register_iterator;
+
+	this->hardware.saveState(&state);
+	for (register_iterator = 0; register_iterator < NUM_REGISTERS; register_iterator++) {
+		reply += toHex(state.registers[register_iterator], 2);
+	}
+	reply += toHex(state.index, 4);
+	reply += toHex(state.program_counter, 4);
+	reply += toHex(state.stack_pointer, 2);
+	reply += toHex(state.timer_delay, 2);
+	reply += toHex(state.timer_sound, 2);
+	return reply;
+}
+
+// Sets the registers from a hex string in debugger order
+uint8_t GDBStub::writeRegisters(const std::string & hex) {
+	CHIP8State state;
+	int register_iterator;
+
+	if (hex.size() < NUM_REGISTERS * 2 + 14) {
+		return 0;
+	}
+	this->hardware.saveState(&state);
+	for (register_iterator = 0; register_iterator < NUM_REGISTERS; register_iterator++) {
+		state.registers[register_iterator] = fromHex(hex, register_iterator * 2, 2);
+	}
+	state.index = fromHex(hex, NUM_REGISTERS * 2, 4);
+	state.program_counter = fromHex(hex, NUM_REGISTERS * 2 + 4, 4);
+	state.stack_pointer = fromHex(hex, NUM_REGISTERS * 2 + 8, 2);
+	state.timer_delay = fromHex(hex, NUM_REGISTERS * 2 + 10, 2);
+	state.timer_sound = fromHex(hex, NUM_REGISTERS * 2 + 12, 2);
+	this->hardware.loadState(&state);
+	return 1;
+}
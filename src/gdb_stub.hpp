@@ -0,0 +1,141 @@
+#ifndef _H_GDB_STUB
+#define _H_GDB_STUB
+
+#include <cstdint>
+#include <string>
+
+#include "chip8.hpp"
+
+// Cycles run between checks for an interrupt from the debugger while continuing
+#define GDB_CONTINUE_BATCH 4096
+// Largest packet the stub accepts
+#define GDB_PACKET_SIZE 4096
+// Number of registers sent to the debugger: V0-VF, I, PC, SP, DT, ST
+#define GDB_NUM_REGISTERS (NUM_REGISTERS + 5)
+
+/*
+* Serves a CHIP-8 emulator to a debugger over the GDB remote serial protocol.
+* Registers are sent in the order V0-VF, I, PC, SP, DT, ST with I and PC as
+* 2 byte big endian values and the rest as single bytes.
+* Breakpoints and write watchpoints are kept in per-address bitmaps and the
+* stub is the debug policy passed to CHIP8::run, so the check only exists in
+* runs made through the stub.
+*/
+class GDBStub {
+public:
+	/********************
+	* Creates a debug stub for an emulator
+	* @param hardware Emulator being debugged
+	********************/
+	GDBStub(CHIP8 & hardware);
+
+	/********************
+	* Closes any open sockets
+	********************/
+	~GDBStub();
+
+	/********************
+	* Listens for a debugger on a local TCP port
+	* @param port Port on 127.0.0.1 to listen on
+	* @return 1 if listening, 0 on error
+	********************/
+	uint8_t listenTCP(int port);
+
+	/********************
+	* Listens for a debugger on a unix socket
+	* @param path File system path of the socket
+	* @return 1 if listening, 0 on error
+	********************/
+	uint8_t listenUnix(std::string path);
+
+	/********************
+	* Waits for a debugger to connect and serves it until it detaches or disconnects
+	********************/
+	void serve();
+
+	/********************
+	* Debug policy check made by CHIP8::run before each cycle.
+	* Stops before opcodes with a breakpoint. Write watchpoints are reported the way the
+	* protocol expects, after the opcode writing to the watched address has run, so memory
+	* already holds the new value when the debugger is told.
+	* @param hardware Emulator about to run a cycle
+	********************/
+	bool shouldBreak(const CHIP8 & hardware);
+
+private:
+	/* Emulator being debugged */
+	CHIP8 & hardware;
+	/* Socket listening for a debugger */
+	int listen_socket = -1;
+	/* Socket connected to the debugger */
+	int client_socket = -1;
+	/* Path of the unix socket to remove when closing */
+	std::string unix_path;
+	/* One bit per address with a breakpoint */
+	uint64_t breakpoints[MEMORY_SIZE / 64] = {};
+	/* One bit per address with a write watchpoint */
+	uint64_t watchpoints[MEMORY_SIZE / 64] = {};
+	/* Address of the pending breakpoint to step over when resuming */
+	int resume_address = -1;
+	/* Set when the opcode about to run writes to a watched address, the emulator stops after it */
+	uint8_t watch_hit = 0;
+	/* Reply describing why the emulator last stopped */
+	std::string stop_reply = "S05";
+
+	/********************
+	* Checks if an address is set in a bitmap
+	********************/
+	static bool testBit(const uint64_t * bitmap, uint16_t address) {
+		return (bitmap[(address & MEMORY_MASK) / 64] >> (address % 64)) & 1;
+	}
+
+	/********************
+	* Sets or clears a range of addresses in a bitmap
+	********************/
+	static void setBits(uint64_t * bitmap, uint16_t address, int length, bool value);
+
+	/********************
+	* Reads the next packet from the debugger, acknowledging it
+	* @param packet String to store the packet contents in
+	* @return 1 if a packet was read, 0 if the debugger disconnected
+	********************/
+	uint8_t readPacket(std::string & packet);
+
+	/********************
+	* Sends a packet to the debugger
+	* @param packet Contents of the packet
+	********************/
+	void sendPacket(const std::string & packet);
+
+	/********************
+	* Checks if the debugger has sent an interrupt (0x03) without blocking
+	********************/
+	uint8_t interrupted();
+
+	/********************
+	* Runs the emulator until it stops, returning the stop reply
+	* @param single Run a single cycle instead of continuing
+	********************/
+	std::string resume(bool single);
+
+	/********************
+	* Handles a packet and returns the reply
+	* @param packet Contents of the packet
+	* @param done   Set when the debugger has detached or killed the session
+	********************/
+	std::string handlePacket(const std::string & packet, bool & done);
+
+	/********************
+	* Gets the registers as a hex string in debugger order
+	********************/
+	std::string readRegisters();
+
+	/********************
+	* Sets the registers from a hex string in debugger order
+	* @param hex Value of every register in the order readRegisters sends them
+	* @return 1 if the registers were set, 0 if the string is too short to hold them all
+	********************/
+	uint8_t writeRegisters(const std::string & hex);
+};
+
+#endif
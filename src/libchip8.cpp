@@ -0,0 +1,163 @@
+#include "libchip8.h"
+#include "chip8.hpp"
+#include "rom_cache.hpp"
+
+// The C snapshot is copied field by field, make sure the sizes agree
+static_assert(sizeof(((chip8_state_t *) 0)->memory) == MEMORY_SIZE, "C state memory size mismatch");
+static_assert(sizeof(((chip8_state_t *) 0)->registers) == NUM_REGISTERS, "C state register count mismatch");
+static_assert(sizeof(((chip8_state_t *) 0)->stack) == STACK_SIZE * sizeof(uint16_t), "C state stack size mismatch");
+static_assert(CHIP8_DISPLAY_ROW_BYTES * CHIP8_DISPLAY_HEIGHT == sizeof(((CHIP8 *) 0)->display), "C display size mismatch");
+static_assert(sizeof(((chip8_state_t *) 0)->display) == sizeof(((CHIP8State *) 0)->display), "C state display size mismatch");
+
+struct chip8 {
+	CHIP8 hardware;
+};
+
+// Creates a new emulator in a clean state
+chip8_t * chip8_create(void) {
+	// Exceptions must not unwind into the C caller
+	try {
+		return new chip8();
+	} catch (...) {
+		return NULL;
+	}
+}
+
+// Destroys an emulator created with chip8_create
+void chip8_destroy(chip8_t * emulator) {
+	delete emulator;
+}
+
+// Resets the emulator to a clean state
+void chip8_reset(chip8_t * emulator) {
+	emulator->hardware.reset();
+}
+
+// Resets the emulator and reloads the program last loaded.
+void chip8_restart(chip8_t * emulator) {
+	emulator->hardware.restart();
+}
+
+// Loads a program from a buffer into the emulators memory
+int chip8_load_rom(chip8_t * emulator, const uint8_t * rom, size_t length) {
+	if (length > MEMORY_SIZE - PROGRAM_START) {
+		return -1;
+	}
+	try {
+		return emulator->hardware.loadProgram(rom, (int) length) ? 0 : -1;
+	} catch (...) {
+		return -1;
+	}
+}
+
+// Empties the process wide cache of loaded programs.
+void chip8_clear_rom_cache(void) {
+	ROMCache::clear();
+}
+
+// Runs a number of cycles on the emulator
+int chip8_step(chip8_t * emulator, uint32_t cycles) {
+	NoDebug no_debug;
+
+	// Writing to a shared memory page allocates a copy of it
+	try {
+		emulator->hardware.run(cycles, no_debug);
+	} catch (...) {
+		return -1;
+	}
+	return 0;
+}
+
+// Runs cycles until the display is redrawn or CHIP8_FRAME_CYCLES cycles have run
+int chip8_run_frame(chip8_t * emulator) {
+	int cycle_iterator;
+
+	emulator->hardware.drawFlag = 0;
+	try {
+		for (cycle_iterator = 0; cycle_iterator < CHIP8_FRAME_CYCLES; cycle_iterator++) {
+			emulator->hardware.cycle();
+			if (emulator->hardware.drawFlag) {
+				emulator->hardware.drawFlag = 0;
+				return 1;
+			}
+		}
+	} catch (...) {
+		return -1;
+	}
+	return 0;
+}
+
+// Sets the state of the keypad
+void chip8_set_keys(chip8_t * emulator, uint16_t mask) {
+	int key_iterator;
+
+	for (key_iterator = 0; key_iterator < KEYPAD_SIZE; key_iterator++) {
+		emulator->hardware.keypad[key_iterator] = (mask >> key_iterator) & 1;
+	}
+}
+
+// Copies the machine state of the emulator
+void chip8_get_state(const chip8_t * emulator, chip8_state_t * state) {
+	CHIP8State snapshot;
+
+	emulator->hardware.saveState(&snapshot);
+	state->opcode = snapshot.opcode;
+	state->index = snapshot.index;
+	state->program_counter = snapshot.program_counter;
+	memcpy(state->registers, snapshot.registers, sizeof(state->registers));
+	state->timer_delay = snapshot.timer_delay;
+	state->timer_sound = snapshot.timer_sound;
+	memcpy(state->stack, snapshot.stack, sizeof(state->stack));
+	state->stack_pointer = snapshot.stack_pointer;
+	memcpy(state->memory, snapshot.memory, sizeof(state->memory));
+	memcpy(state->display, snapshot.display, sizeof(state->display));
+	state->random_state = snapshot.random_state;
+	state->fault_flag = snapshot.fault_flag;
+	state->quirk_shift_vy = snapshot.quirks.shift_vy;
+	state->quirk_load_store_index = snapshot.quirks.load_store_index;
+	state->quirk_jump_vx = snapshot.quirks.jump_vx;
+	state->quirk_logic_reset_vf = snapshot.quirks.logic_reset_vf;
+	state->machine_cycles = snapshot.machine_cycles;
+	state->frame_cycles = snapshot.frame_cycles;
+}
+
+// Restores the machine state of the emulator
+int chip8_set_state(chip8_t * emulator, const chip8_state_t * state) {
+	CHIP8State snapshot;
+
+	snapshot.opcode = state->opcode;
+	snapshot.index = state->index;
+	snapshot.program_counter = state->program_counter;
+	memcpy(snapshot.registers, state->registers, sizeof(snapshot.registers));
+	snapshot.timer_delay = state->timer_delay;
+	snapshot.timer_sound = state->timer_sound;
+	memcpy(snapshot.stack, state->stack, sizeof(snapshot.stack));
+	snapshot.stack_pointer = state->stack_pointer;
+	memcpy(snapshot.memory, state->memory, sizeof(snapshot.memory));
+	memcpy(snapshot.display, state->display, sizeof(snapshot.display));
+	snapshot.random_state = state->random_state;
+	snapshot.fault_flag = state->fault_flag;
+	snapshot.quirks.shift_vy = state->quirk_shift_vy;
+	snapshot.quirks.load_store_index = state->quirk_load_store_index;
+	snapshot.quirks.jump_vx = state->quirk_jump_vx;
+	snapshot.quirks.logic_reset_vf = state->quirk_logic_reset_vf;
+	snapshot.machine_cycles = state->machine_cycles;
+	snapshot.frame_cycles = state->frame_cycles;
+	// Restoring memory allocates the pages that differ
+	try {
+		emulator->hardware.loadState(&snapshot);
+	} catch (...) {
+		return -1;
+	}
+	return 0;
+}
+
+// Checks if the program has overflowed or underflowed the stack since the last reset
+int chip8_faulted(const chip8_t * emulator) {
+	return emulator->hardware.faultFlag ? 1 : 0;
+}
+
+// Gets the display of the emulator without copying it.
+const uint8_t * chip8_framebuffer(const chip8_t * emulator) {
+	return emulator->hardware.display;
+}
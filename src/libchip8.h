@@ -0,0 +1,159 @@
+#ifndef _H_LIBCHIP8
+#define _H_LIBCHIP8
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+* C interface to the CHIP-8 core for embedding the emulator in other programs.
+* No C++ exception leaves the library, calls that can run out of memory report it
+* in their return value. Each emulator instance is independent, so distinct instances may be driven
+* from different threads at the same time. A single instance must not be used
+* from more than one thread at once.
+*/
+
+#if defined(_WIN32)
+#define CHIP8_API __declspec(dllexport)
+#else
+#define CHIP8_API __attribute__((visibility("default")))
+#endif
+
+#define CHIP8_DISPLAY_WIDTH 64
+#define CHIP8_DISPLAY_HEIGHT 32
+// Bytes in each row of the framebuffer, one bit per pixel
+#define CHIP8_DISPLAY_ROW_BYTES (CHIP8_DISPLAY_WIDTH / 8)
+// Most cycles chip8_run_frame will run waiting for the display to be redrawn
+#define CHIP8_FRAME_CYCLES 1000
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque handle to an emulator instance */
+typedef struct chip8 chip8_t;
+
+/* Snapshot of the machine state, excluding the keypad */
+typedef struct chip8_state {
+	uint16_t opcode;
+	uint16_t index;
+	uint16_t program_counter;
+	uint8_t  registers[16];
+	uint8_t  timer_delay;
+	uint8_t  timer_sound;
+	uint16_t stack[16];
+	uint8_t  stack_pointer;
+	uint8_t  memory[4096];
+	// Framebuffer laid out as chip8_framebuffer returns it
+	uint8_t  display[CHIP8_DISPLAY_ROW_BYTES * CHIP8_DISPLAY_HEIGHT];
+	// State of the random number generator used by 0xCXNN, 0 reseeds it
+	uint32_t random_state;
+	uint8_t  fault_flag;
+	// Interpreter behaviours, 1 when the COSMAC VIP / CHIP-48 behaviour is followed
+	uint8_t  quirk_shift_vy;
+	uint8_t  quirk_load_store_index;
+	uint8_t  quirk_jump_vx;
+	uint8_t  quirk_logic_reset_vf;
+	// Cycle counters of the VIP timing model, 0 when it is not compiled in
+	uint64_t machine_cycles;
+	uint32_t frame_cycles;
+} chip8_state_t;
+
+/*******************************
+* Creates a new emulator in a clean state
+* @return the new emulator, or NULL if it could not be allocated
+*******************************/
+CHIP8_API chip8_t * chip8_create(void);
+
+/*******************************
+* Destroys an emulator created with chip8_create
+* @param emulator Emulator to destroy
+*******************************/
+CHIP8_API void chip8_destroy(chip8_t * emulator);
+
+/*******************************
+* Resets the emulator to a clean state
+* @param emulator Emulator to reset
+*******************************/
+CHIP8_API void chip8_reset(chip8_t * emulator);
+
+/*******************************
+* Resets the emulator and reloads the program last loaded.
+* Programs are cached by content, so restarting only shares the cached pages.
+* @param emulator Emulator to restart
+*******************************/
+CHIP8_API void chip8_restart(chip8_t * emulator);
+
+/*******************************
+* Loads a program from a buffer into the emulators memory
+* @param emulator Emulator to load the program into
+* @param rom      Bytes of the program
+* @param length   Number of bytes in the program
+* @return 0 on success, -1 if the program is empty, does not fit in memory or memory ran out
+*******************************/
+CHIP8_API int chip8_load_rom(chip8_t * emulator, const uint8_t * rom, size_t length);
+
+/*******************************
+* Empties the process wide cache of loaded programs. The cache keeps the 64 programs
+* loaded most recently, emulators keep the programs they have loaded.
+*******************************/
+CHIP8_API void chip8_clear_rom_cache(void);
+
+/*******************************
+* Runs a number of cycles on the emulator
+* @param emulator Emulator to run
+* @param cycles   Number of cycles to run
+* @return 0 on success, -1 if memory ran out
+*******************************/
+CHIP8_API int chip8_step(chip8_t * emulator, uint32_t cycles);
+
+/*******************************
+* Runs cycles until the display is redrawn or CHIP8_FRAME_CYCLES cycles have run
+* @param emulator Emulator to run
+* @return 1 if the display was redrawn, 0 otherwise, -1 if memory ran out
+*******************************/
+CHIP8_API int chip8_run_frame(chip8_t * emulator);
+
+/*******************************
+* Sets the state of the keypad
+* @param emulator Emulator to set the keys of
+* @param mask     Bit N is set when key N is pressed
+*******************************/
+CHIP8_API void chip8_set_keys(chip8_t * emulator, uint16_t mask);
+
+/*******************************
+* Copies the machine state of the emulator
+* @param emulator Emulator to copy the state of
+* @param state    Snapshot to store the state in
+*******************************/
+CHIP8_API void chip8_get_state(const chip8_t * emulator, chip8_state_t * state);
+
+/*******************************
+* Restores the machine state of the emulator
+* @param emulator Emulator to restore the state of
+* @param state    Snapshot to restore the state from
+* @return 0 on success, -1 if memory ran out
+*******************************/
+CHIP8_API int chip8_set_state(chip8_t * emulator, const chip8_state_t * state);
+
+/*******************************
+* Checks if the program has overflowed or underflowed the stack since the last reset
+* @param emulator Emulator to check
+* @return 1 if the stack has faulted, 0 otherwise
+*******************************/
+CHIP8_API int chip8_faulted(const chip8_t * emulator);
+
+/*******************************
+* Gets the display of the emulator without copying it.
+* The display is CHIP8_DISPLAY_HEIGHT rows of CHIP8_DISPLAY_ROW_BYTES bytes, each
+* byte holds 8 pixels with the leftmost in the most significant bit. A bit is 1
+* when the pixel is on and 0 when it is off. The pointer stays valid until the
+* emulator is destroyed.
+* @param emulator Emulator to get the display of
+*******************************/
+CHIP8_API const uint8_t * chip8_framebuffer(const chip8_t * emulator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
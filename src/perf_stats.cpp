@@ -0,0 +1,99 @@
+#include "perf_stats.hpp"
+
+#include <iostream>
+
+// Records an input
+void PerfStats::inputReceived(uint64_t now) {
+	if (this->pending_input == 0) {
+		this->pending_input = now;
+	}
+}
+
+// Records a presented frame
+void PerfStats::framePresented(uint64_t now, uint64_t render_time, uint64_t present_time) {
+	uint64_t bucket;
+
+	this->window_host_frames++;
+	this->window_render_time += render_time;
+	this->window_present_time += present_time;
+	// Place the time since the last frame in the histogram
+	if (this->last_present != 0) {
+		bucket = (now - this->last_present) / PERF_HISTOGRAM_BUCKET_SIZE;
+		this->window_histogram[bucket < PERF_HISTOGRAM_BUCKETS ? bucket : PERF_HISTOGRAM_BUCKETS - 1]++;
+	}
+	this->last_present = now;
+	// The first input since the last frame is now on screen
+	if (this->pending_input != 0) {
+		this->window_latency += now - this->pending_input;
+		this->window_inputs++;
+		this->pending_input = 0;
+	}
+}
+
+// Updates the rates when the current window has ended
+uint8_t PerfStats::update(uint64_t now) {
+	uint64_t elapsed;
+	int bucket_iterator;
+
+	if (this->window_start == 0) {
+		this->start = now;
+		this->window_start = now;
+		return 0;
+	}
+	elapsed = now - this->window_start;
+	if (elapsed < PERF_WINDOW) {
+		return 0;
+	}
+
+	// Scale the counters to the length of the window
+	this->instructions_per_second = this->window_instructions * 1000000 / elapsed;
+	this->emulated_fps = (uint64_t) this->window_emulated_frames * 1000000 / elapsed;
+	this->host_fps = (uint64_t) this->window_host_frames * 1000000 / elapsed;
+	this->render_time = this->window_host_frames ? this->window_render_time / this->window_host_frames : 0;
+	this->present_time = this->window_host_frames ? this->window_present_time / this->window_host_frames : 0;
+	this->input_latency = this->window_inputs ? this->window_latency / this->window_inputs : 0;
+	for (bucket_iterator = 0; bucket_iterator < PERF_HISTOGRAM_BUCKETS; bucket_iterator++) {
+		this->histogram[bucket_iterator] = this->window_histogram[bucket_iterator];
+		this->window_histogram[bucket_iterator] = 0;
+	}
+
+	// Start the next window
+	this->window_start = now;
+	this->window_instructions = 0;
+	this->window_emulated_frames = 0;
+	this->window_host_frames = 0;
+	this->window_render_time = 0;
+	this->window_present_time = 0;
+	this->window_latency = 0;
+	this->window_inputs = 0;
+
+	// Append the rates to the stats file
+	if (this->stats_file.is_open()) {
+		this->stats_file << (now - this->start) / 1000000 << " " << this->instructions_per_second << " "
+			<< this->emulated_fps << " " << this->host_fps << " " << this->render_time << " "
+			<< this->present_time << " " << this->input_latency;
+		for (bucket_iterator = 0; bucket_iterator < PERF_HISTOGRAM_BUCKETS; bucket_iterator++) {
+			this->stats_file << " " << this->histogram[bucket_iterator];
+		}
+		this->stats_file << std::endl;
+	}
+	return 1;
+}
+
+// Opens a file the rates are appended to after each window
+uint8_t PerfStats::openFile(std::string file_path) {
+	int bucket_iterator;
+
+	this->stats_file.open(file_path.c_str(), std::ios::out | std::ios::app);
+	if (! this->stats_file.is_open()) {
+		std::cout << "Stats file " << file_path << " could not be opened" << std::endl;
+		return 0;
+	}
+	// Describe the columns
+	this->stats_file << "# seconds instructions_per_second emulated_fps host_fps render_us present_us input_latency_us";
+	for (bucket_iterator = 0; bucket_iterator < PERF_HISTOGRAM_BUCKETS; bucket_iterator++) {
+		this->stats_file << " frames_" << bucket_iterator * PERF_HISTOGRAM_BUCKET_SIZE / 1000 << "ms";
+	}
+	this->stats_file << std::endl;
+	return 1;
+}
@@ -0,0 +1,101 @@
+#ifndef _H_PERF_STATS
+#define _H_PERF_STATS
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Microseconds the counters are gathered over before the rates are updated
+#define PERF_WINDOW 1000000
+// Number of buckets in the frame time histogram, the last bucket holds every longer frame
+#define PERF_HISTOGRAM_BUCKETS 16
+// Microseconds of frame time covered by each histogram bucket
+#define PERF_HISTOGRAM_BUCKET_SIZE 2000
+
+/*
+* Performance counters for a running emulator, gathered over one second windows.
+* Times are passed in by the caller in microseconds so the counters do not
+* depend on the display.
+*/
+class PerfStats {
+public:
+	/* Emulated instructions per second over the last window */
+	uint64_t instructions_per_second = 0;
+	/* Display updates made by the program per second over the last window */
+	uint32_t emulated_fps = 0;
+	/* Frames presented to the screen per second over the last window */
+	uint32_t host_fps = 0;
+	/* Average microseconds spent drawing a frame over the last window */
+	uint32_t render_time = 0;
+	/* Average microseconds spent waiting to present a frame (vsync) over the last window */
+	uint32_t present_time = 0;
+	/* Average microseconds from an input to the next presented frame over the last window */
+	uint32_t input_latency = 0;
+	/* Frame times between presented frames over the last window */
+	uint32_t histogram[PERF_HISTOGRAM_BUCKETS] = {};
+
+	/*******************************
+	* Counts instructions run by the emulator
+	* @param count Number of instructions run
+	*******************************/
+	void addInstructions(uint32_t count) {
+		this->window_instructions += count;
+	}
+
+	/*******************************
+	* Counts a display update made by the program
+	*******************************/
+	void emulatedFrame() {
+		this->window_emulated_frames++;
+	}
+
+	/*******************************
+	* Records an input, the latency is measured from the first input before each presented frame
+	* @param now Current time in microseconds
+	*******************************/
+	void inputReceived(uint64_t now);
+
+	/*******************************
+	* Records a presented frame
+	* @param now          Current time in microseconds
+	* @param render_time  Microseconds spent drawing the frame
+	* @param present_time Microseconds spent waiting to present the frame
+	*******************************/
+	void framePresented(uint64_t now, uint64_t render_time, uint64_t present_time);
+
+	/*******************************
+	* Updates the rates when the current window has ended, writing them to the stats file if one is open
+	* @param now Current time in microseconds
+	* @return 1 if the rates were updated, 0 otherwise
+	*******************************/
+	uint8_t update(uint64_t now);
+
+	/*******************************
+	* Opens a file the rates are appended to after each window
+	* @param file_path Path to the stats file
+	* @return 1 if the file was opened, 0 otherwise
+	*******************************/
+	uint8_t openFile(std::string file_path);
+
+private:
+	/* Stats file being written, if any */
+	std::ofstream stats_file;
+	/* Time the stats started and the current window started */
+	uint64_t start = 0;
+	uint64_t window_start = 0;
+	/* Time of the last presented frame */
+	uint64_t last_present = 0;
+	/* Time of the first input since the last presented frame, 0 when there is none */
+	uint64_t pending_input = 0;
+	/* Counters for the current window */
+	uint64_t window_instructions = 0;
+	uint32_t window_emulated_frames = 0;
+	uint32_t window_host_frames = 0;
+	uint64_t window_render_time = 0;
+	uint64_t window_present_time = 0;
+	uint64_t window_latency = 0;
+	uint32_t window_inputs = 0;
+	uint32_t window_histogram[PERF_HISTOGRAM_BUCKETS] = {};
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "rom_cache.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::mutex ROMCache::cache_lock;
+std::unordered_map<uint64_t, ROMCache::Entry> ROMCache::images;
+uint64_t ROMCache::loads = 0;
+
+// Maps a file into memory and gets its cached image
+std::shared_ptr<const ROMImage> ROMCache::load(std::string file_path) {
+	int file_descriptor;
+	struct stat file_status;
+	void * mapping;
+	std::shared_ptr<const ROMImage> image;
+
+	file_descriptor = open(file_path.c_str(), O_RDONLY);
+	if (file_descriptor < 0) {
+		std::cout << "File " << file_path << " could not be opened: " << strerror(errno) << std::endl;
+		return nullptr;
+	}
+	if (fstat(file_descriptor, &file_status) != 0) {
+		std::cout << "File " << file_path << " could not be read: " << strerror(errno) << std::endl;
+		close(file_descriptor);
+		return nullptr;
+	}
+	// Ensure the file is the correct size
+	if (file_status.st_size == 0) {
+		std::cout << "File " << file_path << " is empty" << std::endl;
+		close(file_descriptor);
+		return nullptr;
+	}
+	if (file_status.st_size > (MEMORY_SIZE - PROGRAM_START)) {
+		std::cout << "File " << file_path << " (" << file_status.st_size << ") larger than avaiable CHIP8 memory ("
+		<< MEMORY_SIZE - PROGRAM_START << ")" << std::endl;
+		close(file_descriptor);
+		return nullptr;
+	}
+	mapping = mmap(NULL, file_status.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	close(file_descriptor);
+	if (mapping == MAP_FAILED) {
+		std::cout << "File " << file_path << " could not be mapped: " << strerror(errno) << std::endl;
+		return nullptr;
+	}
+	image = ROMCache::load((const uint8_t *) mapping, file_status.st_size);
+	munmap(mapping, file_status.st_size);
+	return image;
+}
+
+// Gets the cached image of a program in a buffer
+std::shared_ptr<const ROMImage> ROMCache::load(const uint8_t * program, int length) {
+	uint64_t program_hash;
+	int page_iterator;
+	int page_offset;
+	int page_length;
+	std::shared_ptr<ROMImage> image;
+	std::shared_ptr<const ROMImage> cached;
+
+	// Ensure the program is the correct size
+	if (length <= 0 || length > (MEMORY_SIZE - PROGRAM_START)) {
+		return nullptr;
+	}
+	program_hash = ROMCache::hash(program, length);
+	{
+		std::lock_guard<std::mutex> guard(ROMCache::cache_lock);
+		cached = ROMCache::find(program_hash, program, length);
+	}
+	if (cached != nullptr) {
+		return cached;
+	}
+	// Build and analyze the image without holding the lock so other loads are not held up
+	image = std::make_shared<ROMImage>();
+	image->hash = program_hash;
+	image->length = length;
+	image->memory = CHIP8::pristineMemory();
+	for (page_iterator = PROGRAM_START / MEMORY_PAGE_SIZE; page_iterator < image->pageEnd(); page_iterator++) {
+		page_offset = page_iterator * MEMORY_PAGE_SIZE - PROGRAM_START;
+		page_length = std::min(MEMORY_PAGE_SIZE, length - page_offset);
+		image->memory.loadPage(page_iterator, &program[page_offset], page_length);
+	}
+	ROMAnalyzer::analyze(program, length, &image->analysis);
+	std::lock_guard<std::mutex> guard(ROMCache::cache_lock);
+	// Another thread may have added the program while this one was building it
+	cached = ROMCache::find(program_hash, program, length);
+	if (cached != nullptr) {
+		return cached;
+	}
+	if (ROMCache::images.count(program_hash) == 0 && ROMCache::images.size() >= ROM_CACHE_SIZE) {
+		ROMCache::evict();
+	}
+	ROMCache::images[program_hash] = Entry { image, ++ROMCache::loads };
+	return image;
+}
+
+// Gets the cached image of a program, the cache lock must be held
+std::shared_ptr<const ROMImage> ROMCache::find(uint64_t program_hash, const uint8_t * program, int length) {
+	auto cached = ROMCache::images.find(program_hash);
+
+	// Reuse the cached image unless a different program collides with it
+	if (cached == ROMCache::images.end() || ! ROMCache::matches(*cached->second.image, program, length)) {
+		return nullptr;
+	}
+	cached->second.last_used = ++ROMCache::loads;
+	return cached->second.image;
+}
+
+// Removes the least recently loaded image from the cache, the cache lock must be held
+void ROMCache::evict() {
+	auto oldest = ROMCache::images.begin();
+
+	for (auto entry = ROMCache::images.begin(); entry != ROMCache::images.end(); entry++) {
+		if (entry->second.last_used < oldest->second.last_used) {
+			oldest = entry;
+		}
+	}
+	if (oldest != ROMCache::images.end()) {
+		ROMCache::images.erase(oldest);
+	}
+}
+
+// Removes every image from the cache.
+void ROMCache::clear() {
+	std::lock_guard<std::mutex> guard(ROMCache::cache_lock);
+	ROMCache::images.clear();
+}
+
+// Hashes a program with 64 bit FNV-1a
+uint64_t ROMCache::hash(const uint8_t * program, int length) {
+	uint64_t result;
+	int byte_iterator;
+
+	result = 0xCBF29CE484222325ULL;
+	for (byte_iterator = 0; byte_iterator < length; byte_iterator++) {
+		result ^= program[byte_iterator];
+		result *= 0x100000001B3ULL;
+	}
+	return result;
+}
+
+// Checks if an image holds exactly the given program
+uint8_t ROMCache::matches(const ROMImage & image, const uint8_t * program, int length) {
+	int page_iterator;
+	int page_offset;
+	int page_length;
+
+	if (image.length != length) {
+		return 0;
+	}
+	for (page_iterator = PROGRAM_START / MEMORY_PAGE_SIZE; page_iterator < image.pageEnd(); page_iterator++) {
+		page_offset = page_iterator * MEMORY_PAGE_SIZE - PROGRAM_START;
+		page_length = std::min(MEMORY_PAGE_SIZE, length - page_offset);
+		if (memcmp(image.memory.page(page_iterator), &program[page_offset], page_length) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
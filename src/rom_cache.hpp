@@ -0,0 +1,110 @@
+#ifndef _H_ROM_CACHE
+#define _H_ROM_CACHE
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "chip8.hpp"
+#include "analyzer.hpp"
+
+// Most program images kept in the cache, the least recently loaded image is evicted past this
+#define ROM_CACHE_SIZE 64
+
+/* A program laid out in memory pages, ready to be shared into CHIP-8 memory */
+struct ROMImage {
+	/* FNV-1a hash of the program bytes */
+	uint64_t hash;
+	/* Number of bytes in the program */
+	int length;
+	/* Code and data map of the program and the quirks it relies on */
+	ROMAnalysis analysis;
+	/* Memory of a freshly reset CHIP-8 with the program loaded at PROGRAM_START */
+	PagedMemory memory;
+	/*******************************
+	* Gets the page after the last page the program occupies
+	*******************************/
+	int pageEnd() const {
+		return (PROGRAM_START + this->length + MEMORY_PAGE_SIZE - 1) / MEMORY_PAGE_SIZE;
+	}
+};
+
+/*
+* Process wide cache of program images keyed by the hash of their contents.
+* Each program is analyzed when it is first added to the cache, outside of the
+* cache lock so loading other programs is not held up by the analysis.
+* Loading the same program again, from any path or buffer, returns the image
+* already in the cache so emulators share its pages. At most ROM_CACHE_SIZE images
+* are kept, emulators keep the memory of images evicted after they were loaded.
+* Safe to use from many threads.
+*/
+class ROMCache {
+public:
+	/*******************************
+	* Maps a file into memory and gets its cached image
+	* @param file_path Path to the file that is being loaded
+	* @return the program image, or nullptr if the file could not be loaded
+	*******************************/
+	static std::shared_ptr<const ROMImage> load(std::string file_path);
+
+	/*******************************
+	* Gets the cached image of a program in a buffer
+	* @param program Bytes of the program being loaded
+	* @param length  Number of bytes in the program
+	* @return the program image, or nullptr if the program is empty or does not fit in memory
+	*******************************/
+	static std::shared_ptr<const ROMImage> load(const uint8_t * program, int length);
+
+	/*******************************
+	* Removes every image from the cache. Emulators keep the images they have loaded.
+	*******************************/
+	static void clear();
+
+private:
+	/* A cached image and when it was last loaded */
+	struct Entry {
+		std::shared_ptr<const ROMImage> image;
+		uint64_t last_used;
+	};
+
+	/* Guards the cached images */
+	static std::mutex cache_lock;
+	/* Cached images by the hash of their contents */
+	static std::unordered_map<uint64_t, Entry> images;
+	/* Number of loads from the cache, orders the entries by when they were last loaded */
+	static uint64_t loads;
+
+	/*******************************
+	* Gets the cached image of a program, the cache lock must be held
+	* @param program_hash Hash of the program
+	* @param program      Bytes of the program
+	* @param length       Number of bytes in the program
+	* @return the cached image, or nullptr if the program is not cached
+	*******************************/
+	static std::shared_ptr<const ROMImage> find(uint64_t program_hash, const uint8_t * program, int length);
+
+	/*******************************
+	* Removes the least recently loaded image from the cache, the cache lock must be held
+	*******************************/
+	static void evict();
+
+	/*******************************
+	* Hashes a program with 64 bit FNV-1a
+	* @param program Bytes of the program
+	* @param length  Number of bytes in the program
+	*******************************/
+	static uint64_t hash(const uint8_t * program, int length);
+
+	/*******************************
+	* Checks if an image holds exactly the given program
+	* @param image   Image to compare
+	* @param program Bytes of the program
+	* @param length  Number of bytes in the program
+	*******************************/
+	static uint8_t matches(const ROMImage & image, const uint8_t * program, int length);
+};
+
+#endif
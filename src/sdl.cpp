@@ -41,12 +41,19 @@ void SDLDisplay::destroy() {
 
 // Refreshes the display to reflect any changes
 void SDLDisplay::refresh() {
+	uint64_t present_start;
+
 	this->unlockScreen();
-	// Create a new texture from the display surface
+	// Replace the texture with a new one from the display surface
+	if (this->display_texture != nullptr) {
+		SDL_DestroyTexture(this->display_texture);
+	}
 	this->display_texture = SDL_CreateTextureFromSurface(this->display_renderer, this->display_surface);
-	// Display the texture in the window
+	// Display the texture in the window, timing the wait for vsync
 	SDL_RenderCopy(this->display_renderer, this->display_texture, NULL, NULL);
+	present_start = this->microseconds();
 	SDL_RenderPresent(this->display_renderer);
+	this->last_present_time = this->microseconds() - present_start;
 	this->lockScreen();
 }
 
@@ -77,6 +84,89 @@ uint8_t SDLDisplay::getPixel(int row, int cell) {
 	return *pixel_location;
 }
 
+// Draws the performance overlay over the top left of the display.
+void SDLDisplay::drawOverlay(const PerfStats & stats) {
+	uint32_t text_color;
+	uint32_t bar_color;
+	uint32_t tallest;
+	int line_height;
+	int bars_top;
+	int bar_width;
+	int bar_height;
+	int bucket_iterator;
+	int line_iterator;
+	const uint64_t values[] = {
+		stats.instructions_per_second, stats.emulated_fps, stats.host_fps,
+		stats.render_time, stats.present_time, stats.input_latency
+	};
+	const char labels[] = "ABCDEF";
+
+	text_color = SDL_MapRGB(this->display_surface->format, 0, 255, 0);
+	bar_color = SDL_MapRGB(this->display_surface->format, 255, 255, 0);
+	line_height = 7 * OVERLAY_SCALE;
+	bar_width = 3 * OVERLAY_SCALE;
+	bars_top = 6 * line_height + OVERLAY_SCALE;
+
+	// Clear a box behind the overlay so it reads over the game
+	this->fillRect(0, 0, 12 * 5 * OVERLAY_SCALE, bars_top + OVERLAY_HISTOGRAM_HEIGHT + 2 * OVERLAY_SCALE,
+		SDL_MapRGB(this->display_surface->format, 0, 0, 0));
+	// One labelled value per line
+	for (line_iterator = 0; line_iterator < 6; line_iterator++) {
+		this->drawText(OVERLAY_SCALE, OVERLAY_SCALE + line_iterator * line_height,
+			std::string(1, labels[line_iterator]) + " " + std::to_string(values[line_iterator]), text_color);
+	}
+	// Histogram bars scaled to the fullest bucket
+	tallest = 1;
+	for (bucket_iterator = 0; bucket_iterator < PERF_HISTOGRAM_BUCKETS; bucket_iterator++) {
+		tallest = stats.histogram[bucket_iterator] > tallest ? stats.histogram[bucket_iterator] : tallest;
+	}
+	for (bucket_iterator = 0; bucket_iterator < PERF_HISTOGRAM_BUCKETS; bucket_iterator++) {
+		bar_height = stats.histogram[bucket_iterator] * OVERLAY_HISTOGRAM_HEIGHT / tallest;
+		this->fillRect(OVERLAY_SCALE + bucket_iterator * bar_width, bars_top + OVERLAY_HISTOGRAM_HEIGHT - bar_height,
+			bar_width - 1, bar_height, bar_color);
+	}
+}
+
+// Fills a rectangle of true pixels with a color
+void SDLDisplay::fillRect(int x, int y, int width, int height, uint32_t color) {
+	int row_iterator;
+	int cell_iterator;
+
+	for (row_iterator = y; row_iterator < y + height && row_iterator < this->pixel_height; row_iterator++) {
+		for (cell_iterator = x; cell_iterator < x + width && cell_iterator < this->pixel_width; cell_iterator++) {
+			*((uint32_t *) this->display_surface->pixels + row_iterator * this->pixel_width + cell_iterator) = color;
+		}
+	}
+}
+
+// Draws a line of text with the CHIP-8 font.
+void SDLDisplay::drawText(int x, int y, std::string text, uint32_t color) {
+	int glyph;
+	int row_iterator;
+	int cell_iterator;
+
+	for (char character : text) {
+		// Find the glyph of the hex digit, 5 rows of 4 pixels in the high bits
+		glyph = -1;
+		if (character >= '0' && character <= '9') {
+			glyph = character - '0';
+		} else if (character >= 'A' && character <= 'F') {
+			glyph = character - 'A' + 10;
+		}
+		if (glyph >= 0) {
+			for (row_iterator = 0; row_iterator < 5; row_iterator++) {
+				for (cell_iterator = 0; cell_iterator < 4; cell_iterator++) {
+					if (chip8_fontset[glyph * 5 + row_iterator] & (0x80 >> cell_iterator)) {
+						this->fillRect(x + cell_iterator * OVERLAY_SCALE, y + row_iterator * OVERLAY_SCALE,
+							OVERLAY_SCALE, OVERLAY_SCALE, color);
+					}
+				}
+			}
+		}
+		x += 5 * OVERLAY_SCALE;
+	}
+}
+
 // Initialize the SDL systems
 void SDLDisplay::initialize() {
 	//Compute the pixel dimensions
@@ -114,12 +204,17 @@ void SDLDisplay::initialize() {
 }
 
 // Check the keymap and set the results array to 1 at each pressed
-void SDLDisplay::setKeys(uint8_t keys, int * keymap, uint8_t * results) {
+uint8_t SDLDisplay::setKeys(uint8_t keys, int * keymap, uint8_t * results) {
 	int keymap_iterator;
 	SDL_Event e;
 	uint8_t * keystates;
+	uint8_t changed;
 
+	changed = 0;
 	while (SDL_PollEvent(&e)){
+		if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
+			changed = 1;
+		}
 		if (e.type == SDL_KEYDOWN) {
 			keystates = (uint8_t *) SDL_GetKeyboardState(NULL);
 			// Check each key in the keymap
@@ -129,6 +224,12 @@ void SDLDisplay::setKeys(uint8_t keys, int * keymap, uint8_t * results) {
 			}
 		}
 	}
+	return changed;
+}
+
+// Check if a single key is currently held down
+uint8_t SDLDisplay::keyPressed(int scancode) {
+	return SDL_GetKeyboardState(NULL)[scancode] ? 1 : 0;
 }
 
 // Locks the SDL screen for display
@@ -151,3 +252,31 @@ void SDLDisplay::unlockScreen() {
 void SDLDisplay::sleep(int ms) {
 	SDL_Delay(ms);
 }
+
+// Gets the number of milliseconds since the display was initialized
+uint32_t SDLDisplay::ticks() {
+	return SDL_GetTicks();
+}
+
+// Gets a high resolution time in microseconds
+uint64_t SDLDisplay::microseconds() {
+	uint64_t counter;
+	uint64_t frequency;
+
+	// Split the conversion so high frequency counters do not overflow
+	counter = SDL_GetPerformanceCounter();
+	frequency = SDL_GetPerformanceFrequency();
+	return counter / frequency * 1000000 + counter % frequency * 1000000 / frequency;
+}
+
+// Gets the microseconds the last refresh spent waiting to present (vsync)
+uint64_t SDLDisplay::presentTime() {
+	return this->last_present_time;
+}
+
+// Turns waiting for vsync when presenting on or off
+void SDLDisplay::setVSync(uint8_t enabled) {
+	if (SDL_RenderSetVSync(this->display_renderer, enabled) != 0) {
+		std::cout << "SDL_RenderSetVSync Error: " << SDL_GetError() << std::endl;
+	}
+}
@@ -4,9 +4,18 @@
 #define SDL_WINDOW_NAME "CHIP-8 Emulator"
 
 #include <iostream>
+#include <string>
 #include <inttypes.h>
 #include <SDL2/SDL.h>
 
+#include "font_set.hpp"
+#include "perf_stats.hpp"
+
+// Screen pixels per font pixel in the overlay
+#define OVERLAY_SCALE 2
+// Height in screen pixels of the tallest histogram bar in the overlay
+#define OVERLAY_HISTOGRAM_HEIGHT 24
+
 class SDLDisplay {
 
 public:
@@ -71,8 +80,46 @@ public:
 	* @param keys    number of keys in keymap
 	* @param keymap  keys to check if are active
 	* @param results result array location to store pressed keys
+	* @return 1 if any key was pressed or released, 0 otherwise
 	*******************/
-	void setKeys(uint8_t keys, int * keymap, uint8_t * results);
+	uint8_t setKeys(uint8_t keys, int * keymap, uint8_t * results);
+
+	/*******************
+	* Check if a single key is currently held down
+	* @param scancode sdl scancode of the key to check
+	*******************/
+	uint8_t keyPressed(int scancode);
+
+	/*******************************
+	* Gets the number of milliseconds since the display was initialized
+	*******************************/
+	uint32_t ticks();
+
+	/*******************************
+	* Gets a high resolution time in microseconds
+	*******************************/
+	uint64_t microseconds();
+
+	/*******************************
+	* Gets the microseconds the last refresh spent waiting to present (vsync)
+	*******************************/
+	uint64_t presentTime();
+
+	/*******************************
+	* Turns waiting for vsync when presenting on or off
+	* @param enabled 1 to wait for vsync, 0 to present immediately
+	*******************************/
+	void setVSync(uint8_t enabled);
+
+	/*******************************
+	* Draws the performance overlay over the top left of the display.
+	* Each line is a hex digit label followed by a decimal value, drawn with the CHIP-8 font:
+	*   A instructions per second, B emulated frames per second, C host frames per second,
+	*   D render microseconds, E present (vsync) microseconds, F input latency microseconds
+	* followed by the frame time histogram with one bar per bucket.
+	* @param stats Counters to show
+	*******************************/
+	void drawOverlay(const PerfStats & stats);
 
 	/*******************************
 	* Sleep the sdl display thread
@@ -84,7 +131,7 @@ private:
 	/* Screen display should write to */
 	SDL_Window * display_window;
 	SDL_Renderer * display_renderer;
-	SDL_Texture * display_texture;
+	SDL_Texture * display_texture = nullptr;
 	SDL_Surface * display_surface;
 
 	/* Zoom level of the display */
@@ -101,6 +148,28 @@ private:
 	/* Flag for if display is locked */
 	uint8_t locked;
 
+	/* Microseconds the last refresh spent waiting to present */
+	uint64_t last_present_time = 0;
+
+	/*******************
+	* Fills a rectangle of true pixels with a color
+	* @param x      true pixel column of the left edge
+	* @param y      true pixel row of the top edge
+	* @param width  true pixel width of the rectangle
+	* @param height true pixel height of the rectangle
+	* @param color  surface color to fill with
+	*******************/
+	void fillRect(int x, int y, int width, int height, uint32_t color);
+
+	/*******************
+	* Draws a line of text with the CHIP-8 font. Only hex digits are drawn, anything else is a space.
+	* @param x     true pixel column of the left edge
+	* @param y     true pixel row of the top edge
+	* @param text  hex digits to draw
+	* @param color surface color to draw with
+	*******************/
+	void drawText(int x, int y, std::string text, uint32_t color);
+
 	/*******************
 	* Initialize the SDL systems
 	*******************/